@@ -13,8 +13,7 @@
 #include <lib/c/string.h>
 #include <lib/queue.h>
 #include <lib/types.h>
-#include <process/scheduler.h>
-#include <process/thread.h>
+#include <process/wait_queue.h>
 
 #include "ps2_keyboard.h"
 
@@ -50,7 +49,7 @@ static size_t ring_count;
 
 static int shift_down;
 static int e0_prefix;
-static TAILQ_HEAD(, thread) waiters;
+static wait_queue_t waiters = WAIT_QUEUE_INITIALIZER(waiters);
 
 static int
 ring_push(uint8_t c)
@@ -76,18 +75,6 @@ ring_pop(uint8_t *out)
 	return 0;
 }
 
-static void
-wake_one_waiter(void)
-{
-	thread_t *t = TAILQ_FIRST(&waiters);
-
-	if (!t)
-		return;
-
-	TAILQ_REMOVE(&waiters, t, next);
-	scheduler_insert_thread(t);
-}
-
 static char
 scancode_to_ascii(uint8_t sc)
 {
@@ -144,8 +131,9 @@ keyboard_irq(int irq_level)
 	if (!c)
 		return;
 
+	// One key for one reader
 	if (ring_push((uint8_t)c) == 0)
-		wake_one_waiter();
+		wait_queue_wake_one(&waiters);
 }
 
 static void
@@ -158,8 +146,6 @@ drain_buffer(void)
 void
 keyboard_setup(void)
 {
-	TAILQ_INIT(&waiters);
-
 	drain_buffer();
 	x86_irq_set_routine(IRQ_KEYBOARD, keyboard_irq);
 	/* Unmask only after the handler is installed. */
@@ -167,6 +153,20 @@ keyboard_setup(void)
 			X86_IRQ_BASE + IRQ_KEYBOARD);
 }
 
+// The interrupt handler may run on this CPU: keep it out of the ring.
+static bool
+keyboard_pop(uint8_t *c)
+{
+	uint32_t flags;
+	int ret;
+
+	X86_IRQs_DISABLE(flags);
+	ret = ring_pop(c);
+	X86_IRQs_ENABLE(flags);
+
+	return ret == 0;
+}
+
 size_t
 keyboard_read(void *buf, size_t len)
 {
@@ -179,21 +179,8 @@ keyboard_read(void *buf, size_t len)
 	while (n < len)
 	{
 		uint8_t c;
-		uint32_t flags;
-
-		X86_IRQs_DISABLE(flags);
-		while (ring_pop(&c) != 0)
-		{
-			thread_t *current = thread_get_current();
-
-			current->state = THREAD_BLOCKED;
-			scheduler_remove_thread(current);
-			TAILQ_INSERT_TAIL(&waiters, current, next);
-			X86_IRQs_ENABLE(flags);
-			schedule();
-			X86_IRQs_DISABLE(flags);
-		}
-		X86_IRQs_ENABLE(flags);
+
+		wait_event_exclusive(&waiters, keyboard_pop(&c));
 
 		dst[n++] = c;
 	}
@@ -11,7 +11,6 @@
 #include <lib/c/stdio.h>
 #include <lib/c/stdbool.h>
 #include <arch/x86/irq.h>
-#include <arch/x86/paging.h>
 #include <drivers/vbe.h>
 #include "rtl8139.h"
 #include "pci.h"
@@ -63,8 +62,6 @@
 #define RX_PHYSICAL 0x4000
 #define RX_MULTICAST 0x8000
 
-#define NB_TX_DESCRIPTORS 4
-
 #define ETH_MIN_LENGTH 60
 #define ETH_FRAME_LEGTH 1514
 
@@ -91,17 +88,12 @@ handle_rx(void)
 			return;
 		}
 
-		rxpacket_t *packet = malloc(sizeof(rxpacket_t) - 1 + rx_size - 4);
+		rxpacket_t *packet = object_pool_alloc(&rtl8139_device.rx_packets);
 		if (packet == NULL)
 			return;
 
 		// Discard FCS
 		packet->length = rx_size - 4;
-		if (packet->length <= 0)
-		{
-			free(packet);
-			return;
-		}
 
 		if (offset + 4 + rx_size - 4 > RX_BUFFER_LENGTH)
 		{
@@ -116,9 +108,9 @@ handle_rx(void)
 
 		// Align on 4 bytes
 		rtl8139_device.rx_buffer_idx = ((uint32_t)rtl8139_device.rx_buffer_idx + (uint32_t)rx_size + 4 + 3) & ~ 3UL;
-		out16(rtl8139_device.io_base + RX_BUF_PTR, (uint16_t)((uint32_t)rtl8139_device.rx_buffer_idx - 0x10i));
+		out16(rtl8139_device.io_base + RX_BUF_PTR, (uint16_t)((uint32_t)rtl8139_device.rx_buffer_idx - 0x10));
 
-		free(packet);
+		object_pool_free(&rtl8139_device.rx_packets, packet);
 	}
 }
 
@@ -186,6 +178,9 @@ send_packet(const void *data, size_t length)
 	uint32_t flags;
 	bool is_available = false;
 
+	if (length > TX_BUFFER_SIZE || !rtl8139_device.tx_buffers[0])
+		return -1;
+
 	X86_IRQs_DISABLE(flags);
 
 	if (in32((uint16_t)(rtl8139_device.io_base + TX_STATUS + (rtl8139_device.tx_buffer_idx * 4))) & TX_HOST_OWNS)
@@ -193,23 +188,20 @@ send_packet(const void *data, size_t length)
 		// A free buffer was found.
 
 		// Copy data to TX buffer.
-		memcpy_s(rtl8139_device.tx_buffer + (TX_BUFFER_SIZE * rtl8139_device.tx_buffer_idx),
-			length,
-			data,
-			length);
+		uint8_t *tx_buffer = rtl8139_device.tx_buffers[rtl8139_device.tx_buffer_idx];
+
+		memcpy_s(tx_buffer, TX_BUFFER_SIZE, data, length);
 
 		// Padding
 		while (length < ETH_MIN_LENGTH)
 		{
-			(rtl8139_device.tx_buffer +
-			 (TX_BUFFER_SIZE * rtl8139_device.tx_buffer_idx))[length++] = '\0';
+			tx_buffer[length++] = '\0';
 		}
 
 		// Move TX buffer's content to the internal transmission FIFO
 		// and then to PCI bus.
 		out32((uint16_t)(rtl8139_device.io_base + TX_ADDRESS + rtl8139_device.tx_buffer_idx * 4),
-				(uint32_t)(rtl8139_device.tx_buffer +
-					(TX_BUFFER_SIZE * rtl8139_device.tx_buffer_idx)));
+				rtl8139_device.tx_buffers_dma[rtl8139_device.tx_buffer_idx]);
 
 		out32((uint16_t)(rtl8139_device.io_base + TX_STATUS + rtl8139_device.tx_buffer_idx * 4),
 				((TX_FIFO_THRESHOLD << 11) & 0x003F0000) | length);
@@ -274,35 +266,42 @@ rtl8139_setup(void)
 		/* Wait for RST to be done */
 	}
 
-	// 5. Init the receive buffer
-	rtl8139_device.rx_buffer = malloc(RX_BUFFER_LENGTH);
+	// 5. Init the receive buffer: the ring must be physically contiguous,
+	// below 4 GiB, on a 4-byte boundary (any page base satisfies it)
+	rtl8139_device.rx_buffer = dma_alloc_coherent(RX_BUFFER_LENGTH,
+			&rtl8139_device.rx_buffer_dma, DMA_MASK_32BIT, 0, 0);
 
 	if (!rtl8139_device.rx_buffer)
 	{
 		return;
 	}
 
-	memset(rtl8139_device.rx_buffer, 0x0, RX_BUFFER_LENGTH);
-	out32(rtl8139_device.io_base + RX_BUF, VA2PA(rtl8139_device.rx_buffer));
+	out32(rtl8139_device.io_base + RX_BUF, rtl8139_device.rx_buffer_dma);
 	out32(rtl8139_device.io_base + RX_BUF_PTR, 0);
 	out32(rtl8139_device.io_base + RX_BUF_ADDR, 0);
 
 	rtl8139_device.rx_buffer_idx = 0;
 
-	// and Tx buffer DMA addresses
-	rtl8139_device.tx_buffer = malloc(TX_BUFFER_SIZE * NB_TX_DESCRIPTORS);
+	object_pool_init(&rtl8139_device.rx_packets, "rtl8139-rx",
+			sizeof(rxpacket_t) - 1 + ETH_FRAME_LEGTH, NULL, NULL);
 
-	if (!rtl8139_device.tx_buffer)
+	// and Tx buffer DMA addresses (dword aligned)
+	if (dma_pool_create(&rtl8139_device.tx_pool, "rtl8139-tx",
+			TX_BUFFER_SIZE, NB_TX_DESCRIPTORS, DMA_MASK_32BIT, 4, 0)
+			!= KERNEL_OK)
 	{
-		free(rtl8139_device.rx_buffer);
+		dma_free_coherent(rtl8139_device.rx_buffer, RX_BUFFER_LENGTH);
 		rtl8139_device.rx_buffer = NULL;
 		return;
 	}
 
 	for (uint16_t i = 0; i < NB_TX_DESCRIPTORS; i++)
 	{
+		rtl8139_device.tx_buffers[i] = dma_pool_alloc(&rtl8139_device.tx_pool,
+				&rtl8139_device.tx_buffers_dma[i]);
+
 		out32((uint16_t)(rtl8139_device.io_base + TX_ADDRESS + (i * 4)),
-				VA2PA(rtl8139_device.tx_buffer + (TX_BUFFER_SIZE * i)));
+				rtl8139_device.tx_buffers_dma[i]);
 	}
 
 	// 6. Set IMR + ISR, enable some interrupts
@@ -8,10 +8,14 @@
 #pragma once
 
 #include <lib/types.h>
+#include <memory/dma.h>
+#include <memory/object_pool.h>
 
 #define RTL8139_VENDOR_ID 0x10EC
 #define RTL8139_DEVICE_ID 0x8139
 
+#define NB_TX_DESCRIPTORS 4
+
 typedef struct rtl8139_dev {
 	uint8_t  bar_type;
 	uint16_t io_base;
@@ -19,9 +23,13 @@ typedef struct rtl8139_dev {
 	bool     eeprom_exist;
 	uint8_t  mac_addr[6];
 	uint8_t  *rx_buffer;
+	dma_addr_t rx_buffer_dma;
 	uint32_t rx_buffer_idx;
-	uint8_t  *tx_buffer;
+	dma_pool_t tx_pool;
+	uint8_t  *tx_buffers[NB_TX_DESCRIPTORS];
+	dma_addr_t tx_buffers_dma[NB_TX_DESCRIPTORS];
 	volatile uint32_t tx_buffer_idx;
+	object_pool_t rx_packets;	/* copies handed to the protocol layers */
 } rtl8139_dev_t;
 
 typedef struct rxpacket
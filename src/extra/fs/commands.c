@@ -2,10 +2,21 @@
 #include <lib/c/string.h>
 #include <lib/c/stdlib.h>
 #include <lib/c/stdbool.h>
+#include <process/pi_mutex.h>
 #include "commands.h"
 
 #define FS_PATH_MAX 256
 
+/*
+ * Lookups walk the tree without a lock, see resolve_node(). Changes are
+ * made one at a time under tree_lock, so that readers see either the old
+ * state or the new one: nodes are filled in before being linked, unlinked
+ * ones are freed after a grace period, and moves bump tarfs_rename_seq.
+ * The commands run from system calls, under the kernel lock, and never
+ * sleep: until that changes, nobody waits for tree_lock.
+ */
+static pi_mutex_t tree_lock = PI_MUTEX_INITIALIZER(tree_lock);
+
 static int
 is_directory(struct node *n)
 {
@@ -95,7 +106,7 @@ name_exists(struct node *dir, const char *name)
 {
 	struct node *n;
 
-	LIST_FOREACH(n, &dir->u.folder.nodes, next)
+	LIST_FOREACH_RCU(n, &dir->u.folder.nodes, next)
 	{
 		if (!strncmp(n->name, name, NODE_NAME_LENGTH))
 			return 1;
@@ -160,7 +171,7 @@ cmd_cd(struct node *root, struct node **cwd, const char *path)
 }
 
 static int
-cmd_create(struct node *root, struct node *cwd, const char *path,
+create_locked(struct node *root, struct node *cwd, const char *path,
 		uint8_t type)
 {
 	char dir[FS_PATH_MAX];
@@ -194,7 +205,45 @@ cmd_create(struct node *root, struct node *cwd, const char *path,
 	else
 		new_node->u.file.size = 0;
 
-	LIST_INSERT_HEAD(&parent->u.folder.nodes, new_node, next);
+	LIST_INSERT_HEAD_RCU(&parent->u.folder.nodes, new_node, next);
+	return KERNEL_OK;
+}
+
+static int
+cmd_create(struct node *root, struct node *cwd, const char *path,
+		uint8_t type)
+{
+	int status;
+
+	pi_mutex_lock(&tree_lock);
+	status = create_locked(root, cwd, path, type);
+	pi_mutex_unlock(&tree_lock);
+
+	return status;
+}
+
+// Unlink node and free it once lookups are done with it.
+static int
+remove_node(struct node *root, struct node *cwd, const char *path,
+		uint8_t type)
+{
+	struct node *node;
+
+	pi_mutex_lock(&tree_lock);
+
+	node = resolve_node_wrapper(path, root, cwd);
+
+	if (!node || node->type != type)
+	{
+		pi_mutex_unlock(&tree_lock);
+		return -KERNEL_NO_SUCH_FILE_OR_FOLDER;
+	}
+
+	LIST_REMOVE_RCU(node, next);
+
+	pi_mutex_unlock(&tree_lock);
+
+	call_rcu(&node->rcu, free, node);
 	return KERNEL_OK;
 }
 
@@ -213,31 +262,13 @@ cmd_touch(struct node *root, struct node *cwd, const char *path)
 int
 cmd_rm(struct node *root, struct node *cwd, const char *path)
 {
-	struct node *node;
-
-	node = resolve_node_wrapper(path, root, cwd);
-
-	if (!node || node->type != TMPFS_FILE)
-		return -KERNEL_NO_SUCH_FILE_OR_FOLDER;
-
-	LIST_REMOVE(node, next);
-	free(node);
-	return KERNEL_OK;
+	return remove_node(root, cwd, path, TMPFS_FILE);
 }
 
 int
 cmd_rmdir(struct node *root, struct node *cwd, const char *path)
 {
-	struct node *node;
-
-	node = resolve_node_wrapper(path, root, cwd);
-
-	if (!node || !is_directory(node))
-		return -KERNEL_NO_SUCH_FILE_OR_FOLDER;
-
-	LIST_REMOVE(node, next);
-	free(node);
-	return KERNEL_OK;
+	return remove_node(root, cwd, path, TMPFS_FOLDER);
 }
 
 int
@@ -280,7 +311,7 @@ cmd_file(struct node *root, struct node *cwd, const char *path)
 }
 
 static int
-mv_cp_internal(struct node *root, struct node *cwd,
+mv_cp_locked(struct node *root, struct node *cwd,
 		const char *src_path, const char *dst_path, bool is_mv)
 {
 	struct node *src_node;
@@ -316,7 +347,7 @@ mv_cp_internal(struct node *root, struct node *cwd,
 
 	struct node *n;
 
-	LIST_FOREACH(n, &dst_dir->u.folder.nodes, next)
+	LIST_FOREACH_RCU(n, &dst_dir->u.folder.nodes, next)
 	{
 		if (n != src_node
 		    && !strncmp(n->name, new_name, NODE_NAME_LENGTH))
@@ -345,17 +376,34 @@ mv_cp_internal(struct node *root, struct node *cwd,
 			LIST_INIT(&new_node->u.folder.nodes);
 		}
 
-		LIST_INSERT_HEAD(&dst_dir->u.folder.nodes, new_node, next);
+		LIST_INSERT_HEAD_RCU(&dst_dir->u.folder.nodes, new_node, next);
 		return KERNEL_OK;
 	}
 
-	LIST_REMOVE(src_node, next);
+	// Lookups on src_node's way would follow it to dst_dir: retry them
+	write_seqbegin(&tarfs_rename_seq);
+	LIST_REMOVE_RCU(src_node, next);
 	strzcpy(src_node->name, new_name, NODE_NAME_LENGTH);
 	src_node->name_length = strnlen(new_name, NODE_NAME_LENGTH) + 1;
-	LIST_INSERT_HEAD(&dst_dir->u.folder.nodes, src_node, next);
+	LIST_INSERT_HEAD_RCU(&dst_dir->u.folder.nodes, src_node, next);
+	write_seqend(&tarfs_rename_seq);
+
 	return KERNEL_OK;
 }
 
+static int
+mv_cp_internal(struct node *root, struct node *cwd,
+		const char *src_path, const char *dst_path, bool is_mv)
+{
+	int status;
+
+	pi_mutex_lock(&tree_lock);
+	status = mv_cp_locked(root, cwd, src_path, dst_path, is_mv);
+	pi_mutex_unlock(&tree_lock);
+
+	return status;
+}
+
 int
 cmd_mv(struct node *root, struct node *cwd, const char *src_path,
 		const char *dst_path)
@@ -12,6 +12,7 @@
 #include <lib/types.h>
 #include <lib/queue.h>
 #include <arch/x86/paging.h>
+#include <memory/object_pool.h>
 #include "vfs.h"
 #include "tarfs.h"
 
@@ -38,6 +39,7 @@ node_ops_t tarfs_node_ops =
 static struct file_system tarfs;
 static paddr_t initrd_start, initrd_end;
 static struct superblock *mounted_superblock;
+static object_pool_t path_node_pool;
 
 struct path_node
 {
@@ -47,6 +49,8 @@ struct path_node
 
 STAILQ_HEAD(, path_node) path_nodes;
 
+seqcount_t tarfs_rename_seq = SEQCOUNT_INITIALIZER;
+
 static status_t path_nodes_list_delete(void);
 
 
@@ -111,9 +115,7 @@ static status_t
 path_nodes_to_list(const char *path)
 {
 	uint8_t i = 0;
-	char *name  = malloc(NODE_NAME_LENGTH);
-	if (!name)
-		return -KERNEL_NO_MEMORY;
+	char name[NODE_NAME_LENGTH];
 
 	// Skip the first '/'
 	if (path[0] == '/')
@@ -125,10 +127,9 @@ path_nodes_to_list(const char *path)
 		{
 			name[i] = '\0'; // make a string
 
-			struct path_node *pnode = malloc(sizeof(struct path_node));
+			struct path_node *pnode = object_pool_alloc(&path_node_pool);
 			if (!pnode)
 			{
-				free(name);
 				path_nodes_list_delete();
 				return -KERNEL_NO_MEMORY;
 			}
@@ -136,34 +137,26 @@ path_nodes_to_list(const char *path)
 			strzcpy(pnode->name, name, strnlen(name, NODE_NAME_LENGTH)+1);
 			STAILQ_INSERT_TAIL(&path_nodes, pnode, next);
 
-			free(name);
-			name = malloc(NODE_NAME_LENGTH);
-			if (!name)
-			{
-				path_nodes_list_delete();
-				return -KERNEL_NO_MEMORY;
-			}
-
-
 			// Reinitialize
 			i = 0;
 			path++;
 			continue;
 		}
 
-		name[i] = *path;
+		// Overlong components are truncated, as node names are
+		if (i < NODE_NAME_LENGTH - 1)
+			name[i++] = *path;
+
 		path++;
-		i++;
 	}
 
 	// There was a string after the last '/'
 	if (i > 0)
 	{
 		name[i] = '\0';
-		struct path_node *pnode = malloc(sizeof(struct path_node));
+		struct path_node *pnode = object_pool_alloc(&path_node_pool);
 		if (!pnode)
 		{
-			free(name);
 			path_nodes_list_delete();
 			return -KERNEL_NO_MEMORY;
 		}
@@ -173,8 +166,6 @@ path_nodes_to_list(const char *path)
 		STAILQ_INSERT_TAIL(&path_nodes, pnode, next);
 	}
 
-	free(name);
-
 	return KERNEL_OK;
 }
 
@@ -187,45 +178,77 @@ path_nodes_list_delete(void)
 	{
 		node = STAILQ_FIRST(&path_nodes);
 		STAILQ_REMOVE_HEAD(&path_nodes, next);
-		free(node);
+		object_pool_free(&path_node_pool, node);
 	}
 
 	return KERNEL_OK;
 }
 
-struct node *
-resolve_node(const char *path, struct node *root_node)
+// Child of folder named name, under rcu_read_lock().
+static struct node *
+lookup_node(struct node *folder, const char *name)
 {
-	struct node *tmp_node, *node;
-	bool found = false;
+	struct node *node;
 
-	// Create a list of node names separated by '/'
-	path_nodes_to_list(path);
+	if (folder->type != TMPFS_FOLDER)
+		return NULL;
 
-	tmp_node = root_node;
+	LIST_FOREACH_RCU(node, &folder->u.folder.nodes, next)
+	{
+		if (strncmp(name, node->name, strnlen(name, NODE_NAME_LENGTH)+1) == 0)
+			return node;
+	}
+
+	return NULL;
+}
+
+static struct node *
+walk_path(const char *path, struct node *node)
+{
+	char name[NODE_NAME_LENGTH];
 
-	struct path_node *pn;
-	STAILQ_FOREACH(pn, &path_nodes, next)
+	// Skip the first '/'
+	if (path[0] == '/')
+		path++;
+
+	while (node && *path)
 	{
-		LIST_FOREACH(node, &tmp_node->u.folder.nodes, next)
-		{
-			if (strncmp(pn->name, node->name, strnlen(pn->name, NODE_NAME_LENGTH)+1) == 0)
-			{
-				tmp_node = node;
-				found = true;
-			}
-		}
+		uint32_t i = 0;
 
-		if (!found)
+		// Overlong components are truncated, as node names are
+		for (; *path && *path != '/'; path++)
 		{
-			tmp_node = NULL;
-			break;
+			if (i < NODE_NAME_LENGTH - 1)
+				name[i++] = *path;
 		}
+
+		name[i] = '\0';
+
+		if (*path == '/')
+			path++;
+
+		node = lookup_node(node, name);
 	}
 
-	path_nodes_list_delete();
+	return node;
+}
+
+struct node *
+resolve_node(const char *path, struct node *root_node)
+{
+	struct node *node;
+	uint32_t sequence;
+
+	do
+	{
+		sequence = read_seqbegin(&tarfs_rename_seq);
 
-	return tmp_node;
+		rcu_read_lock();
+		node = walk_path(path, root_node);
+		rcu_read_unlock();
+	} while (read_seqretry(&tarfs_rename_seq, sequence));
+
+	return node;
 }
 
 static char *
@@ -471,6 +494,7 @@ tarfs_mount(const char *root_device, const char *mount_point,
 		return -KERNEL_NO_MEMORY;
 	}
 
+	tarfs_superblock->filesystem = &tarfs;
 	tarfs_superblock->root = root_node;
 	*result_rootfs = tarfs_superblock;
 	mounted_superblock = tarfs_superblock;
@@ -498,15 +522,27 @@ free_node_tree(struct node *node)
 	free(node);
 }
 
+static void
+free_superblock(void *arg)
+{
+	struct superblock *superblock = arg;
+
+	free_node_tree(superblock->root);
+	free(superblock);
+}
+
 static status_t
 tarfs_umount(void)
 {
-	if (mounted_superblock)
-	{
-		free_node_tree(mounted_superblock->root);
-		free(mounted_superblock);
-		mounted_superblock = NULL;
-	}
+	struct superblock *superblock = mounted_superblock;
+
+	if (!superblock)
+		return -KERNEL_INVALID_VALUE;
+
+	mounted_superblock = NULL;
+
+	// Lookups may still be walking the tree
+	call_rcu(&superblock->root->rcu, free_superblock, superblock);
 
 	return KERNEL_OK;
 }
@@ -521,6 +557,11 @@ tarfs_init(paddr_t start, paddr_t end)
 	initrd_start = start;
 	initrd_end   = end;
 
+	status_t status = object_pool_init(&path_node_pool, "path-node",
+			sizeof(struct path_node), NULL, NULL);
+	if (status != KERNEL_OK)
+		return status;
+
 	return fs_register(&tarfs);
 }
 
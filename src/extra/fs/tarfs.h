@@ -9,6 +9,7 @@
 
 #include <lib/types.h>
 #include <fs/vfs.h>
+#include <arch/x86/rwlock.h>
 
 #define TMPFS_NODE(node) ((node) ? (tarfs_node_t *)(node)->data : NULL)
 #define FS_NODE(node)    ((node) ? (node)->bp : NULL)
@@ -23,5 +24,18 @@ typedef enum
 /* forward declaration */
 struct tarfs_node;
 
+/*
+ * Moving a node from a folder to another can lead a lookup astray: moves
+ * happen within a write section of this sequence, and lookups that run
+ * into one start over.
+ */
+extern seqcount_t tarfs_rename_seq;
+
 status_t tarfs_init(vaddr_t initrd_start, vaddr_t initrd_end);
+
+/*
+ * Lock-free: the tree may change meanwhile, see commands.c. The node stays
+ * valid as long as the kernel lock is held, as nodes are freed with
+ * call_rcu(), whose callbacks take it.
+ */
 struct node *resolve_node(const char *path, struct node *root_node);
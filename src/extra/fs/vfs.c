@@ -11,9 +11,13 @@
 #include <fs/vfs.h>
 #include <lib/c/string.h>
 #include <lib/c/stdlib.h>
+#include <arch/x86/rwlock.h>
 
 LIST_HEAD(, file_system) file_systems;
 
+// Looked up at each mount, changed when a file system comes or goes
+static rwlock_t file_systems_lock = RWLOCK_INITIALIZER;
+
 status_t
 vfs_list_init(void)
 {
@@ -29,32 +33,68 @@ vfs_init(const char        *root_device,
 	struct superblock **result_rootfs)
 {
 	struct file_system *fs;
+	uint32_t flags;
+	status_t status;
+
+	read_lock_irqsave(&file_systems_lock, flags);
 
 	LIST_FOREACH(fs, &file_systems, next)
 	{
 		if (strncmp(fs_name, fs->name, strnlen(fs->name, FS_NAME_MAXLEN)+1) == 0)
-		{
-			return fs->mount(root_device, mount_point, mount_args,
-					result_rootfs);
-		}
+			break;
 	}
 
-	return -KERNEL_NO_SUCH_DEVICE;
+	// Mounting takes a while: keep it registered, not locked
+	if (fs)
+		atomic_inc(&fs->refcount);
+
+	read_unlock_irqrestore(&file_systems_lock, flags);
+
+	if (!fs)
+		return -KERNEL_NO_SUCH_DEVICE;
+
+	status = fs->mount(root_device, mount_point, mount_args, result_rootfs);
+	if (status != KERNEL_OK)
+		atomic_dec(&fs->refcount);
+
+	return status;
+}
+
+status_t
+vfs_exit(struct superblock *rootfs)
+{
+	struct file_system *fs = rootfs->filesystem;
+	status_t status = fs->umount();
+
+	// Held since vfs_init()
+	if (status == KERNEL_OK)
+		atomic_dec(&fs->refcount);
+
+	return status;
 }
 
 status_t
 fs_register(struct file_system *fs)
 {
 	struct file_system *fs_item;
+	uint32_t flags;
+
+	write_lock_irqsave(&file_systems_lock, flags);
 
 	LIST_FOREACH(fs_item, &file_systems, next)
 	{
 		if (!strncmp(fs->name, fs_item->name, strnlen(fs_item->name, FS_NAME_MAXLEN)+1))
+		{
+			write_unlock_irqrestore(&file_systems_lock, flags);
 			return -KERNEL_FILE_ALREADY_EXISTS;
+		}
 	}
 
+	atomic_set(&fs->refcount, 0);
 	LIST_INSERT_HEAD(&file_systems, fs, next);
 
+	write_unlock_irqrestore(&file_systems_lock, flags);
+
 	return KERNEL_OK;
 }
 
@@ -62,16 +102,32 @@ status_t
 fs_unregister(struct file_system *fs)
 {
 	struct file_system *fs_item;
+	status_t status = -KERNEL_INVALID_VALUE;
+	uint32_t flags;
+
+	write_lock_irqsave(&file_systems_lock, flags);
 
 	LIST_FOREACH(fs_item, &file_systems, next)
 	{
 		if (!strncmp(fs->name, fs_item->name, NAME_MAX))
 		{
+			// Still mounted somewhere
+			if (atomic_read(&fs->refcount) != 0)
+			{
+				status = -KERNEL_BUSY;
+				break;
+			}
+
 			LIST_REMOVE(fs, next);
-			free(fs);
-			return KERNEL_OK;
+			status = KERNEL_OK;
+			break;
 		}
 	}
 
-	return -KERNEL_INVALID_VALUE;
+	write_unlock_irqrestore(&file_systems_lock, flags);
+
+	if (status == KERNEL_OK)
+		free(fs);
+
+	return status;
 }
@@ -13,6 +13,8 @@
 #include <lib/queue.h>
 #include <lib/types.h>
 #include <lib/status.h>
+#include <arch/x86/atomic.h>
+#include <process/rcu.h>
 
 /* Forward declarations */
 struct file_system;
@@ -163,6 +165,7 @@ struct node
 		struct file   file;
 	} u;
 	LIST_ENTRY(node) next;
+	struct rcu_head rcu;		/* to be freed */
 };
 
 struct file_system_ops
@@ -227,7 +230,7 @@ struct file_system
 			const char *mount_args,
 			struct superblock **result_rootfs);
 	status_t (*umount)(void);
-	atomic_count_t refcount;
+	atomic_t refcount;
 
 	LIST_ENTRY(file_system)	next;
 };
@@ -235,7 +238,7 @@ struct file_system
 struct vfs_cache_node
 {
 	struct vfs_node	*node;
-	atomic_count_t	ref_count;
+	atomic_t	ref_count;
 	char 		*name;
 };
 
@@ -280,7 +283,7 @@ struct vnode
 
 	struct vnode_ops *ops;
 
-	atomic_count_t refcount;
+	atomic_t refcount;
 	// TODO mutex
 	// TODO pagecache
 	TAILQ_ENTRY(vnode) next;
@@ -388,6 +391,12 @@ status_t vfs_init(const char       *root_device,
 		const char         *mount_args,
 		struct superblock **result_rootfs);
 
+/*
+ * Unmount what vfs_init() mounted, for its file system to be unregistered.
+ * rootfs may not be used afterwards.
+ */
+status_t vfs_exit(struct superblock *rootfs);
+
 status_t vfs_list_init(void);
 
 
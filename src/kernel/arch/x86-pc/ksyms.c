@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/c/string.h>
+#include <arch/x86/paging.h>
+#include <process/elf_loader.h>
+#include "ksyms.h"
+
+#define MULTIBOOT_INFO_ELF_SHDR	0x20
+
+/* Past the kernel half of the direct map, PA2VA would not be valid */
+#define KSYMS_LIMIT		0x10000000u
+
+extern char __kernel_start;
+
+static const Elf32_Sym *symbols;
+static uint32_t nb_symbols;
+static const char *strings;
+static uint32_t strings_size;
+
+paddr_t
+ksyms_setup(multiboot_info_t *mbi)
+{
+	const Elf32_Shdr *sections;
+	const Elf32_Shdr *symtab;
+	const Elf32_Shdr *strtab;
+	paddr_t start = VA2PA(&__kernel_start);
+
+	if (!(mbi->flags & MULTIBOOT_INFO_ELF_SHDR)
+	    || mbi->size != sizeof(Elf32_Shdr))
+		return 0;
+
+	// Still identity mapped this early
+	sections = (const Elf32_Shdr *)mbi->addr;
+
+	for (uint32_t i = 0; i < mbi->num; i++)
+	{
+		symtab = &sections[i];
+
+		if (symtab->sh_type != SHT_SYMTAB || symtab->sh_link >= mbi->num)
+			continue;
+
+		strtab = &sections[symtab->sh_link];
+
+		// Non-allocated sections are placed by the boot loader, at a
+		// physical address; keep them only if they can be reserved.
+		if (strtab->sh_type != SHT_STRTAB
+		    || symtab->sh_addr < start || strtab->sh_addr < start
+		    || symtab->sh_addr + symtab->sh_size > KSYMS_LIMIT
+		    || strtab->sh_addr + strtab->sh_size > KSYMS_LIMIT)
+			return 0;
+
+		symbols = PA2VA(symtab->sh_addr);
+		nb_symbols = symtab->sh_size / sizeof(Elf32_Sym);
+		strings = PA2VA(strtab->sh_addr);
+		strings_size = strtab->sh_size;
+
+		return symtab->sh_addr + symtab->sh_size
+			> strtab->sh_addr + strtab->sh_size
+			? symtab->sh_addr + symtab->sh_size
+			: strtab->sh_addr + strtab->sh_size;
+	}
+
+	return 0;
+}
+
+const char *
+ksyms_lookup(uint32_t address, uint32_t *offset)
+{
+	const Elf32_Sym *best = NULL;
+
+	for (uint32_t i = 0; i < nb_symbols; i++)
+	{
+		const Elf32_Sym *sym = &symbols[i];
+
+		if (ELF32_ST_TYPE(sym->st_info) != STT_FUNC
+		    || sym->st_value > address || sym->st_name >= strings_size)
+			continue;
+
+		if (!best || sym->st_value > best->st_value)
+			best = sym;
+	}
+
+	if (!best || (best->st_size && address - best->st_value >= best->st_size))
+		return NULL;
+
+	*offset = address - best->st_value;
+
+	return strings + best->st_name;
+}
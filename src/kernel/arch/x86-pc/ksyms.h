@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Kernel symbol table, as loaded by the boot loader from the kernel ELF.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+#include <arch/x86-pc/bootstrap/multiboot.h>
+
+/*
+ * Locate .symtab and .strtab through the multiboot ELF section headers.
+ * Must run before frame_setup: the returned physical address is the end of
+ * the tables, which the caller keeps out of the frame allocator (0 when
+ * there are no usable symbols, e.g. in a stripped kernel).
+ */
+paddr_t ksyms_setup(multiboot_info_t *mbi);
+
+// Name of the function holding address, or NULL; *offset is set from it.
+const char *ksyms_lookup(uint32_t address, uint32_t *offset);
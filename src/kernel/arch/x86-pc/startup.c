@@ -11,6 +11,7 @@
 #include <lib/c/stdio.h>
 #include <lib/c/string.h>
 #include <arch/x86-pc/bootstrap/multiboot.h>
+#include <arch/x86-pc/ksyms.h>
 #include <arch/x86/gdt.h>
 #include <arch/x86/idt.h>
 #include <arch/x86/syscall.h>
@@ -18,37 +19,59 @@
 #include <arch/x86/irq.h>
 #include <arch/x86/pic.h>
 #include <arch/x86/pit.h>
+#include <arch/x86/tsc.h>
+#include <arch/x86/tick.h>
+#include <arch/x86/hpet.h>
+#include <arch/x86/clock.h>
 #include <arch/x86/ioapic.h>
 #include <arch/x86/lapic.h>
 #include <arch/x86/acpi.h>
 #include <arch/x86/smp.h>
+#include <arch/x86/percpu.h>
 #include <memory/frame.h>
 #include <memory/heap.h>
+#include <memory/vm.h>
 #include <arch/x86/paging.h>
 #include <process/thread.h>
 #include <process/process.h>
 #include <process/scheduler.h>
+#include <process/timer.h>
+#include <process/rcu.h>
 #include <fs/tarfs.h>
 #include <drivers/vbe.h>
 #include <drivers/pci.h>
 #include <drivers/rtl8139.h>
 #include <drivers/ps2_keyboard.h>
 #include <process/elf_loader.h>
+#ifdef CONFIG_MUTEX_BENCH
+#include <test-suite/mutex-bench.h>
+#endif
 
-#define TIMER_INTERRUPT    0x20
 #define SPURIOUS_INTERRUPT 0xff
 
 
 struct superblock *root_fs;
 
-extern void pit_interrupt();
+extern void lapic_timer_interrupt();
 extern void spurious_interrupt_handler();
 
+#ifdef CONFIG_MUTEX_BENCH
+// Two contenders per CPU, once the processors have joined
+static void
+mutex_bench_thread(uint32_t arg)
+{
+	(void)arg;
+
+	bench_mutex(2 * nb_cpus, 10000);
+}
+#endif
+
 void
 interrupts_setup(void)
 {
+	// Scheduler tick
+	x86_idt_set_handler(LAPIC_TIMER_INTERRUPT, (uint32_t)lapic_timer_interrupt, 0);
 	// Spurious interrupt
-	x86_idt_set_handler(TIMER_INTERRUPT, (uint32_t)pit_interrupt, 0);
 	x86_idt_set_handler(SPURIOUS_INTERRUPT, (uint32_t)spurious_interrupt_handler, 0);
 
 	// Disable PIC to use Local APIC
@@ -58,12 +81,11 @@ interrupts_setup(void)
 	AcpiInit();
 	LocalApicInit();
 	IoApicInit();
-	// Timer: Raise IRQ0 at 100 HZ rate.
+	// HPET, found by AcpiInit()
+	hpet_setup();
+	// PIT: only counts, for PitWait()
 	status_t status = x86_pit_set_frequency(100);
 	assert(status == KERNEL_OK);
-
-	// Enable IO APIC entries
-	IoApicSetEntry(g_ioApicAddr, AcpiRemapIrq(IRQ_TIMER), TIMER_INTERRUPT);
 }
 
 void
@@ -126,10 +148,28 @@ aragveli_main(uint32_t magic, uint32_t address)
 	// Interrupts
 	interrupts_setup();
 
+	// Processors found by ACPI
+	percpu_setup();
+
+	// Time Stamp Counter, timed against the HPET or the PIT
+	tsc_setup();
+
+	// Monotonic clock
+	clock_setup();
+
+	// Scheduler tick, from the local APIC timer timed alike
+	tick_setup();
+	tick_start();
+
 	// Initrd
 	uint32_t initrd_start = *(uint32_t *)mbi->mods_addr;
 	uint32_t initrd_end   = *(uint32_t *)(mbi->mods_addr + 4);
 
+	// Kernel symbols, reserved along with the initrd
+	paddr_t reserved_end = ksyms_setup(mbi);
+	if (reserved_end < initrd_end)
+		reserved_end = initrd_end;
+
 	// Physical memory
 	paddr_t identity_mapping_start, identity_mapping_end;
 	size_t ram_size = (mbi->mem_upper << 10) + (1 << 20);
@@ -137,7 +177,7 @@ aragveli_main(uint32_t magic, uint32_t address)
 			vbe_mode_info,
 			&identity_mapping_start,
 			&identity_mapping_end,
-			initrd_end);
+			reserved_end);
 	assert(status == KERNEL_OK);
 
 	// Heap
@@ -148,11 +188,15 @@ aragveli_main(uint32_t magic, uint32_t address)
 			framebuffer_end);
 
 	// TSS
-	tss_setup();
+	tss_setup(0);
 
 	// Scheduler
 	scheduler_setup();
 
+	// Timers
+	timer_setup();
+	rcu_setup();
+
 	// Theading
 	threading_setup();
 
@@ -161,8 +205,8 @@ aragveli_main(uint32_t magic, uint32_t address)
 	// System calls
 	system_calls_setup();
 
-	// SMP
-	//SmpInit();
+	// Demand paging of mmap() regions
+	vm_setup();
 
 	uint32_t kernel_stack = frame_alloc();
 	set_kernel_stack((uint32_t)PA2VA(kernel_stack) + PAGE_SIZE);
@@ -173,5 +217,13 @@ aragveli_main(uint32_t magic, uint32_t address)
 
 	/* ELF loading (IRQs stay off until the first scheduled thread irets) */
 	process_create_from_elf("/shell.elf", root_fs->root);
+
+	// SMP: the other processors join the scheduler
+	SmpInit();
+
+#ifdef CONFIG_MUTEX_BENCH
+	thread_kernel_create("mutex-bench", mutex_bench_thread, 0);
+#endif
+
 	scheduler_start();
 }
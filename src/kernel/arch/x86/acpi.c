@@ -27,12 +27,14 @@
 #include "io-ports.h"
 #include "lapic.h"
 #include "ioapic.h"
+#include "hpet.h"
 #include "acpi.h"
 
 #define RSD_PTR_SIGNATURE 0x2052545020445352	// 'RSD PTR '
 #define APIC_SIGNATURE 0x43495041
 #define FACP_SIGNATURE 0x50434146		// 'FACP'
 #define RSDT_SIGNATURE 0x54445352
+#define HPET_SIGNATURE 0x54455048		// 'HPET'
 
 #define SLP_EN		(1 << 13)
 
@@ -76,6 +78,20 @@ typedef struct AcpiFadt
 	uint32_t pm1bControlBlock;
 } __attribute__((packed)) AcpiFadt;
 
+typedef struct AcpiHpet
+{
+	AcpiHeader header;
+	uint32_t eventTimerBlockId;
+	uint8_t addressSpaceId;			// 0: system memory
+	uint8_t registerBitWidth;
+	uint8_t registerBitOffset;
+	uint8_t reserved;
+	uint64_t address;
+	uint8_t hpetNumber;
+	uint16_t minimumTick;
+	uint8_t pageProtection;
+} __attribute__((packed)) AcpiHpet;
+
 // ------------------------------------------------------------------------------------------------
 typedef struct AcpiMadt
 {
@@ -165,6 +181,19 @@ AcpiParseFacp(AcpiFadt *facp)
 	kprintf("ACPI: PM1a_CNT=0x%x\n", (unsigned int)g_pm1a_cnt);
 }
 
+static void
+AcpiParseHpet(AcpiHpet *hpet)
+{
+	// The first one will do; the kernel only maps the low 4 GB
+	if (g_hpet_base || hpet->addressSpaceId != 0
+	    || hpet->address > 0xFFFFFFFF)
+		return;
+
+	g_hpet_base = (uint8_t *)(uintptr_t)hpet->address;
+
+	kprintf("ACPI: HPET at 0x%x\n", (unsigned int)hpet->address);
+}
+
 // ------------------------------------------------------------------------------------------------
 static void
 AcpiParseApic(AcpiMadt *madt)
@@ -257,6 +286,10 @@ AcpiParseDT(AcpiHeader *header)
     {
         AcpiParseApic((AcpiMadt *)header);
     }
+    else if (header->signature == HPET_SIGNATURE)
+    {
+        AcpiParseHpet((AcpiHpet *)header);
+    }
 }
 
 static void
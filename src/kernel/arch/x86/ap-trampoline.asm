@@ -0,0 +1,91 @@
+; Copyright (c) 2026 Konstantin Tcholokachvili.
+; All rights reserved.
+; Use of this source code is governed by a MIT license that can be
+; found in the LICENSE file.
+
+; Application processor startup code.
+;
+; SmpInit() copies everything between ap_trampoline_start and
+; ap_trampoline_end to AP_TRAMPOLINE_BASE, below 1 MiB where a STARTUP IPI
+; can reach it, and fills in ap_trampoline_params. The processor wakes up
+; in real mode at AP_TRAMPOLINE_BASE, so addresses inside the copy are
+; computed by hand with TRAMPOLINE().
+
+[extern ap_main]
+[global ap_trampoline_start]
+[global ap_trampoline_params]
+[global ap_trampoline_end]
+
+AP_TRAMPOLINE_BASE	equ 0x8000	; keep in sync with smp.h
+
+%define TRAMPOLINE(label) ((label) - ap_trampoline_start + AP_TRAMPOLINE_BASE)
+
+section .rodata
+
+bits 16
+align 16
+ap_trampoline_start:
+	cli
+	cld
+
+	xor ax, ax
+	mov ds, ax
+
+	lgdt [TRAMPOLINE(trampoline_gdtr)]
+
+	mov eax, cr0
+	or  eax, 0x00000001		; CR0.PE
+	mov cr0, eax
+
+	jmp dword 0x08:TRAMPOLINE(ap_protected_mode)
+
+bits 32
+ap_protected_mode:
+	mov ax, 0x10
+	mov ds, ax
+	mov es, ax
+	mov fs, ax
+	mov gs, ax
+	mov ss, ax
+
+	; The kernel page directory identity maps the low memory we run from
+	mov eax, [TRAMPOLINE(ap_page_directory)]
+	mov cr3, eax
+
+	mov eax, cr4
+	or  eax, 0x00000010		; CR4.PSE (4 MiB pages)
+	mov cr4, eax
+
+	mov eax, cr0
+	or  eax, 0x80000000		; CR0.PG
+	mov cr0, eax
+
+	mov esp, [TRAMPOLINE(ap_stack)]
+
+	; Absolute jump to the higher half
+	mov eax, ap_main
+	call eax
+
+ap_hang:
+	hlt
+	jmp ap_hang
+
+; Flat code and data segments, replaced by the kernel GDT in ap_main()
+align 8
+trampoline_gdt:
+	dq 0
+	dq 0x00CF9A000000FFFF		; code: base 0, 4 GiB, ring 0
+	dq 0x00CF92000000FFFF		; data: base 0, 4 GiB, ring 0
+trampoline_gdtr:
+	dw trampoline_gdtr - trampoline_gdt - 1
+	dd TRAMPOLINE(trampoline_gdt)
+
+; struct ap_trampoline_params
+align 4
+ap_trampoline_params:
+ap_page_directory:	dd 0		; physical
+ap_stack:		dd 0		; virtual, top of the boot stack
+
+ap_trampoline_end:
+
+section .note.GNU-stack noalloc noexec nowrite
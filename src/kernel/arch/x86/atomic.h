@@ -1,23 +1,243 @@
 /*
- * Copyright (c) 2017 Konstantin Tcholokachvili.
+ * Copyright (c) 2017, 2026 Konstantin Tcholokachvili.
  * All rights reserved.
  * Use of this source code is governed by a MIT license that can be
  * found in the LICENSE file.
+ *
+ * Atomic operations on counters shared between processors.
+ *
+ * On x86 plain loads and stores are not reordered with one another except
+ * for a store followed by a load, and locked instructions are full
+ * barriers. So acquire loads and release stores only need to stop the
+ * compiler; smp_mb() is for the store-load case.
  */
 
 #pragma once
 
 #include <lib/types.h>
+#include <lib/c/stdbool.h>
+
+typedef struct
+{
+	volatile int32_t counter;
+} atomic_t;
+
+typedef struct
+{
+	volatile int64_t counter;
+} __attribute__((aligned(8))) atomic64_t;
+
+#define ATOMIC_INIT(value)	{ (value) }
+
+// Keep the compiler from moving memory accesses across it
+#define barrier()	asm volatile("" ::: "memory")
+
+static inline void
+smp_mb(void)
+{
+	asm volatile("lock; addl $0, (%%esp)" ::: "memory", "cc");
+}
+
+#define smp_rmb()	barrier()
+#define smp_wmb()	barrier()
+
+static inline int32_t
+atomic_read(const atomic_t *a)
+{
+	return a->counter;
+}
+
+static inline void
+atomic_set(atomic_t *a, int32_t value)
+{
+	a->counter = value;
+}
+
+// Later accesses cannot move before it
+static inline int32_t
+atomic_read_acquire(const atomic_t *a)
+{
+	int32_t value = a->counter;
+
+	barrier();
+	return value;
+}
+
+// Earlier accesses cannot move after it
+static inline void
+atomic_set_release(atomic_t *a, int32_t value)
+{
+	barrier();
+	a->counter = value;
+}
+
+// Add value to a, returning what a held before.
+static inline int32_t
+atomic_fetch_add(atomic_t *a, int32_t value)
+{
+	asm volatile("lock xaddl %0, %1"
+		     : "+r"(value), "+m"(a->counter)
+		     :
+		     : "memory", "cc");
+	return value;
+}
+
+static inline void
+atomic_add(atomic_t *a, int32_t value)
+{
+	asm volatile("lock addl %1, %0"
+		     : "+m"(a->counter)
+		     : "ir"(value)
+		     : "memory", "cc");
+}
+
+static inline void
+atomic_inc(atomic_t *a)
+{
+	asm volatile("lock incl %0" : "+m"(a->counter) :: "memory", "cc");
+}
+
+static inline void
+atomic_dec(atomic_t *a)
+{
+	asm volatile("lock decl %0" : "+m"(a->counter) :: "memory", "cc");
+}
+
+// Decrement a; true if it reached 0, for the last reference to free.
+static inline bool
+atomic_dec_and_test(atomic_t *a)
+{
+	uint8_t zero;
+
+	asm volatile("lock decl %0; sete %1"
+		     : "+m"(a->counter), "=qm"(zero)
+		     :
+		     : "memory", "cc");
+	return zero != 0;
+}
+
+/*
+ * Store new_value in a if it holds old_value. Returns what a held: the
+ * exchange took place if it is old_value.
+ */
+static inline int32_t
+atomic_cmpxchg(atomic_t *a, int32_t old_value, int32_t new_value)
+{
+	asm volatile("lock cmpxchgl %2, %1"
+		     : "+a"(old_value), "+m"(a->counter)
+		     : "r"(new_value)
+		     : "memory", "cc");
+	return old_value;
+}
+
+// Store value in a, returning what it held.
+static inline int32_t
+atomic_xchg(atomic_t *a, int32_t value)
+{
+	asm volatile("xchgl %0, %1"
+		     : "+r"(value), "+m"(a->counter)
+		     :
+		     : "memory");
+	return value;
+}
+
+/*
+ * Bit operations on bitmaps of any size, bit nr of the word at addr being
+ * bit nr % 32 of word nr / 32.
+ */
+static inline void
+set_bit(uint32_t nr, volatile uint32_t *addr)
+{
+	asm volatile("lock btsl %1, %0"
+		     : "+m"(*addr)
+		     : "r"(nr)
+		     : "memory", "cc");
+}
 
 static inline void
-atomic_inc(atomic_count_t count)
+clear_bit(uint32_t nr, volatile uint32_t *addr)
+{
+	asm volatile("lock btrl %1, %0"
+		     : "+m"(*addr)
+		     : "r"(nr)
+		     : "memory", "cc");
+}
+
+// Set bit nr, returning whether it was set already.
+static inline bool
+test_and_set_bit(uint32_t nr, volatile uint32_t *addr)
+{
+	uint8_t old;
+
+	asm volatile("lock btsl %2, %0; setc %1"
+		     : "+m"(*addr), "=qm"(old)
+		     : "r"(nr)
+		     : "memory", "cc");
+	return old != 0;
+}
+
+// Clear bit nr, returning whether it was set.
+static inline bool
+test_and_clear_bit(uint32_t nr, volatile uint32_t *addr)
 {
-	asm volatile("\n\tlock incl %0" : "+m"(count));
+	uint8_t old;
+
+	asm volatile("lock btrl %2, %0; setc %1"
+		     : "+m"(*addr), "=qm"(old)
+		     : "r"(nr)
+		     : "memory", "cc");
+	return old != 0;
+}
+
+/*
+ * 64-bit counters. A 32-bit processor cannot load or store 8 bytes at once
+ * with general registers: everything goes through cmpxchg8b.
+ */
+static inline int64_t
+atomic64_cmpxchg(atomic64_t *a, int64_t old_value, int64_t new_value)
+{
+	asm volatile("lock cmpxchg8b %1"
+		     : "+A"(old_value), "+m"(a->counter)
+		     : "b"((uint32_t)new_value),
+		       "c"((uint32_t)((uint64_t)new_value >> 32))
+		     : "memory", "cc");
+	return old_value;
+}
+
+// Compares with whatever guess; either way edx:eax ends up holding a.
+static inline int64_t
+atomic64_read(atomic64_t *a)
+{
+	return atomic64_cmpxchg(a, 0, 0);
+}
+
+static inline int64_t
+atomic64_xchg(atomic64_t *a, int64_t value)
+{
+	int64_t old_value = a->counter;
+	int64_t seen;
+
+	while ((seen = atomic64_cmpxchg(a, old_value, value)) != old_value)
+		old_value = seen;
+
+	return old_value;
 }
 
 static inline void
-atomic_dec(atomic_count_t count)
+atomic64_set(atomic64_t *a, int64_t value)
 {
-	asm volatile("\n\tlock decl %0" : "+m"(count));
+	atomic64_xchg(a, value);
 }
 
+static inline int64_t
+atomic64_fetch_add(atomic64_t *a, int64_t value)
+{
+	int64_t old_value = a->counter;
+	int64_t seen;
+
+	while ((seen = atomic64_cmpxchg(a, old_value, old_value + value))
+	       != old_value)
+		old_value = seen;
+
+	return old_value;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/status.h>
+#include <lib/div64.h>
+#include <lib/c/stdio.h>
+#include "pit.h"
+#include "tsc.h"
+#include "hpet.h"
+#include "clock.h"
+
+static uint64_t (*clock_source)(void) = tsc_ns;
+
+void
+clock_setup(void)
+{
+	if (!tsc_invariant && hpet_has_clock())
+		clock_source = hpet_ns;
+
+	kprintf("Clock: %s\n", clock_source == tsc_ns ? "TSC" : "HPET");
+}
+
+uint64_t
+clock_monotonic_ns(void)
+{
+	return clock_source();
+}
+
+void
+clock_monotonic(struct timespec *ts)
+{
+	ts->tv_sec = (uint32_t)div64_u32(clock_monotonic_ns(), NSEC_PER_SEC,
+					 &ts->tv_nsec);
+}
+
+void
+ndelay(uint32_t ns)
+{
+	uint64_t start = clock_monotonic_ns();
+
+	while (clock_monotonic_ns() - start < ns)
+		asm volatile("pause");
+}
+
+void
+udelay(uint32_t us)
+{
+	while (us > 1000)
+	{
+		ndelay(1000000);
+		us -= 1000;
+	}
+
+	ndelay(us * 1000);
+}
+
+void
+clock_calibration_wait(uint32_t ms)
+{
+	if (hpet_delay(ms * 1000000) != KERNEL_OK)
+		PitWait(ms);
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Monotonic clock and calibrated delays.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+
+#define NSEC_PER_SEC	1000000000
+
+struct timespec
+{
+	uint32_t tv_sec;
+	uint32_t tv_nsec;
+};
+
+/*
+ * Pick the clock source: the TSC, unless it changes rate with the CPU
+ * frequency and there is an HPET with a 64-bit counter.
+ */
+void clock_setup(void);
+
+// Nanoseconds since boot; never goes backwards.
+uint64_t clock_monotonic_ns(void);
+
+void clock_monotonic(struct timespec *ts);
+
+// Busy-wait for at least the given time, interrupts on or off.
+void ndelay(uint32_t ns);
+void udelay(uint32_t us);
+
+// Busy-wait before calibration: on the HPET if there is one, else the PIT.
+void clock_calibration_wait(uint32_t ms);
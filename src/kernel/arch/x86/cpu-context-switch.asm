@@ -28,12 +28,14 @@ cpu_context_switch:
 	o16 push fs		; esp+2
 	o16 push gs		; esp
 
-	; Store the address of the saved context
+	; Store the address of the saved context. Another CPU may resume the
+	; thread as soon as it sees it, so the old stack is not read after this.
 	mov ebx, [esp+60]
+	mov eax, [esp+64]
 	mov [ebx], esp
 
 	; Switching context by changing stack
-	mov esp, [esp+64]
+	mov esp, eax
 
 	; Restore CPU's context
 	o16 pop gs
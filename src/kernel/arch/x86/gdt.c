@@ -10,6 +10,7 @@
 #include <lib/c/stdbool.h>
 #include "gdt.h"
 #include "segment.h"
+#include "percpu.h"
 
 // Describes a GDT entry
 struct x86_gdt_entry
@@ -191,18 +192,19 @@ static struct x86_gdt_entry gdt[] = {
 		.granularity			= 1,	// 4KB pages
 		.base_paged_address_31_24	= 0
 	},
-	[TSS_SEGMENT] = (struct x86_gdt_entry){
+	// One TSS descriptor per CPU, filled by tss_setup()
+	[TSS_SEGMENT + NB_CPUS - 1] = (struct x86_gdt_entry){
 		0,
 	}
 };
 
 
-static struct x86_tss kernel_tss;
+static struct x86_tss kernel_tss[NB_CPUS];
 
-void
-gdt_register_tss(vaddr_t tss_vadd)
+static void
+gdt_register_tss(uint32_t cpu, vaddr_t tss_vadd)
 {
-	gdt[TSS_SEGMENT] = (struct x86_gdt_entry){
+	gdt[TSS_SEGMENT + cpu] = (struct x86_gdt_entry){
 		.segment_limit_15_0		= 0x67,
 		.base_paged_address_15_0	= tss_vadd & 0xffff,
 		.base_paged_address_23_16	= (tss_vadd >> 16) & 0xff,
@@ -218,25 +220,28 @@ gdt_register_tss(vaddr_t tss_vadd)
 		.base_paged_address_31_24	= (uint8_t)((tss_vadd >> 24) & 0xff)
 	};
 
-	uint16_t tss_register_value = X86_BUILD_SEGMENT_REGISTER_VALUE(0, false, TSS_SEGMENT);
+	uint16_t tss_register_value = (uint16_t)X86_BUILD_SEGMENT_REGISTER_VALUE(0,
+			false, TSS_SEGMENT + cpu);
 
 	asm ("ltr %0"::"r"(tss_register_value));
 }
 
 void
-tss_setup(void)
+tss_setup(uint32_t cpu)
 {
-	memset(&kernel_tss, 0x0, sizeof(kernel_tss));
+	struct x86_tss *tss = &kernel_tss[cpu];
+
+	memset(tss, 0x0, sizeof(*tss));
 
-	kernel_tss.ss0 = X86_BUILD_SEGMENT_REGISTER_VALUE(0, false, KERNEL_DATA_SEGMENT);
+	tss->ss0 = X86_BUILD_SEGMENT_REGISTER_VALUE(0, false, KERNEL_DATA_SEGMENT);
 
-	gdt_register_tss((vaddr_t)&kernel_tss);
+	gdt_register_tss(cpu, (vaddr_t)tss);
 }
 
 void
 set_kernel_stack(uint32_t stack)
 {
-	kernel_tss.esp0 = stack;
+	kernel_tss[cpu_current_index()].esp0 = stack;
 }
 
 void
@@ -7,7 +7,10 @@
 
 #pragma once
 
+#include <lib/types.h>
+
 // Setup GDT by initializing the GDTR register.
 void x86_gdt_setup(void);
-void tss_setup(void);
+// Load the TSS of the executing CPU, which becomes CPU number cpu.
+void tss_setup(uint32_t cpu);
 void set_kernel_stack(uint32_t stack);
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/status.h>
+#include <lib/div64.h>
+#include <lib/c/stdio.h>
+#include "mmio.h"
+#include "acpi.h"
+#include "ioapic.h"
+#include "idt.h"
+#include "irq.h"
+#include "hpet.h"
+
+/* General registers */
+#define HPET_CAPABILITIES	0x000	/* high half: period in femtoseconds */
+#define HPET_CONFIG		0x010
+#define HPET_COUNTER		0x0F0
+
+/* Registers of timer n */
+#define HPET_TIMER_CONFIG(n)	 (0x100 + 0x20 * (n))
+#define HPET_TIMER_COMPARATOR(n) (0x108 + 0x20 * (n))
+
+#define CAP_COUNTER_64		(1 << 13)
+#define CAP_LEGACY_ROUTE	(1 << 15)
+
+#define CONFIG_ENABLE		(1 << 0)
+#define CONFIG_LEGACY_ROUTE	(1 << 1)	/* timer 0 raises IRQ0 */
+
+#define TIMER_INT_ENABLE	(1 << 2)
+#define TIMER_32_BITS		(1 << 8)
+
+/* At most 100 ns per count, says the specification */
+#define MAX_PERIOD_FS		100000000
+
+/* Comparators set too close to the counter may be missed */
+#define MIN_EVENT_COUNTS	16
+
+uint8_t *g_hpet_base;
+
+static uint32_t period_fs;
+static bool counter_64;
+static bool legacy_route;
+
+// Nanoseconds are (counts * ns_mult) >> ns_shift
+static uint32_t ns_mult;
+static uint32_t ns_shift;
+
+static volatile hpet_handler_t event_handler;
+
+static uint32_t
+hpet_read(uint32_t reg)
+{
+	return MmioRead32(g_hpet_base + reg);
+}
+
+static void
+hpet_write(uint32_t reg, uint32_t value)
+{
+	MmioWrite32(g_hpet_base + reg, value);
+}
+
+// The two halves are read apart: retry if the low one wrapped in between.
+static uint64_t
+read_counter(void)
+{
+	uint32_t high, low;
+
+	do
+	{
+		high = hpet_read(HPET_COUNTER + 4);
+		low = hpet_read(HPET_COUNTER);
+	} while (high != hpet_read(HPET_COUNTER + 4));
+
+	return ((uint64_t)high << 32) | low;
+}
+
+static void
+hpet_interrupt_handler(int irq)
+{
+	hpet_handler_t handler = event_handler;
+
+	(void)irq;
+
+	event_handler = NULL;
+
+	if (handler)
+		handler();
+}
+
+void
+hpet_setup(void)
+{
+	uint32_t caps;
+
+	if (!g_hpet_base)
+		return;
+
+	caps = hpet_read(HPET_CAPABILITIES);
+	period_fs = hpet_read(HPET_CAPABILITIES + 4);
+
+	if (period_fs == 0 || period_fs > MAX_PERIOD_FS)
+	{
+		kprintf("HPET: invalid period %u fs\n", (unsigned int)period_fs);
+		g_hpet_base = NULL;
+		return;
+	}
+
+	counter_64 = (caps & CAP_COUNTER_64) != 0;
+	legacy_route = (caps & CAP_LEGACY_ROUTE) != 0;
+	mult_shift(period_fs, 1000000, &ns_mult, &ns_shift);
+
+	// Restart from zero, timer 0 off
+	hpet_write(HPET_CONFIG, 0);
+	hpet_write(HPET_COUNTER, 0);
+	hpet_write(HPET_COUNTER + 4, 0);
+	hpet_write(HPET_TIMER_CONFIG(0), 0);
+
+	/*
+	 * The legacy route takes IRQ0 from the PIT, which only counts for
+	 * PitWait() since the local APIC timers tick.
+	 */
+	if (legacy_route)
+	{
+		x86_irq_set_routine(IRQ_TIMER, hpet_interrupt_handler);
+		IoApicSetEntry(g_ioApicAddr, AcpiRemapIrq(IRQ_TIMER),
+			       X86_IRQ_BASE + IRQ_TIMER);
+	}
+
+	hpet_write(HPET_CONFIG,
+		   CONFIG_ENABLE | (legacy_route ? CONFIG_LEGACY_ROUTE : 0));
+
+	kprintf("HPET: %u kHz, %u-bit counter\n",
+		(unsigned int)div64_u32(1000000000000ULL, period_fs, NULL),
+		counter_64 ? 64 : 32);
+}
+
+bool
+hpet_has_clock(void)
+{
+	return g_hpet_base && counter_64;
+}
+
+uint64_t
+hpet_ns(void)
+{
+	return mul64_u32_shr(read_counter(), ns_mult, ns_shift);
+}
+
+status_t
+hpet_delay(uint32_t ns)
+{
+	uint32_t counts, start;
+
+	if (!g_hpet_base)
+		return -KERNEL_NO_SUCH_DEVICE;
+
+	counts = (uint32_t)div64_u32((uint64_t)ns * 1000000, period_fs, NULL);
+	start = hpet_read(HPET_COUNTER);
+
+	// The low half alone, so that 32-bit counters do as well
+	while (hpet_read(HPET_COUNTER) - start < counts)
+		asm volatile("pause");
+
+	return KERNEL_OK;
+}
+
+bool
+hpet_has_events(void)
+{
+	return g_hpet_base && legacy_route;
+}
+
+/*
+ * Timer 0 compares in 32-bit mode whatever the counter width, so that the
+ * comparator is set in a single write; half the range keeps clear of the
+ * wrap around.
+ */
+status_t
+hpet_event_set(uint32_t delay_ns, hpet_handler_t handler)
+{
+	uint64_t counts;
+
+	if (!g_hpet_base || !legacy_route)
+		return -KERNEL_NO_SUCH_DEVICE;
+
+	counts = div64_u32((uint64_t)delay_ns * 1000000, period_fs, NULL);
+	if (counts > 0x7FFFFFFF)
+		counts = 0x7FFFFFFF;
+	else if (counts < MIN_EVENT_COUNTS)
+		counts = MIN_EVENT_COUNTS;
+
+	event_handler = handler;
+
+	// One-shot and edge triggered: the other bits left at 0
+	hpet_write(HPET_TIMER_CONFIG(0), TIMER_INT_ENABLE | TIMER_32_BITS);
+	hpet_write(HPET_TIMER_COMPARATOR(0),
+		   hpet_read(HPET_COUNTER) + (uint32_t)counts);
+
+	return KERNEL_OK;
+}
+
+void
+hpet_event_cancel(void)
+{
+	if (!g_hpet_base)
+		return;
+
+	hpet_write(HPET_TIMER_CONFIG(0), 0);
+	event_handler = NULL;
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * @see [en] IA-PC HPET (High Precision Event Timers) Specification 1.0a
+ *
+ * High Precision Event Timer.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+#include <lib/c/stdbool.h>
+
+// Registers, found by AcpiInit(); NULL without an HPET
+extern uint8_t *g_hpet_base;
+
+typedef void (*hpet_handler_t)(void);
+
+// Start the main counter and take over IRQ0 for the events.
+void hpet_setup(void);
+
+// Whether the main counter is 64 bits wide, and so never wraps.
+bool hpet_has_clock(void);
+
+// Nanoseconds since hpet_setup(); only with hpet_has_clock().
+uint64_t hpet_ns(void);
+
+// Busy-wait on the main counter; fails without an HPET.
+status_t hpet_delay(uint32_t ns);
+
+/*
+ * Call handler once, from the IRQ0 handler, after delay_ns nanoseconds,
+ * replacing any pending event. Longer delays than HPET_EVENT_MAX_NS are
+ * cut short. Fails without an HPET able to route timer 0 to IRQ0.
+ */
+#define HPET_EVENT_MAX_NS	0xFFFFFFFF	/* about 4.3 s */
+
+// Whether hpet_event_set() can work.
+bool hpet_has_events(void);
+
+status_t hpet_event_set(uint32_t delay_ns, hpet_handler_t handler);
+void hpet_event_cancel(void);
@@ -63,8 +63,6 @@ static x86_idt_entry_t idt_array[INTERRUPTS_MAX_LIMIT];
 void
 x86_idt_setup(void)
 {
-	x86_idtr_t idtr;
-
 	for (uint16_t i = 0; i < INTERRUPTS_MAX_LIMIT; i++)
 	{
 		x86_idt_entry_t *idt_entry = idt_array+i;
@@ -82,6 +80,14 @@ x86_idt_setup(void)
 		x86_idt_set_handler(i, (uint32_t)NULL, 0);
 	}
 
+	x86_idt_load();
+}
+
+void
+x86_idt_load(void)
+{
+	x86_idtr_t idtr;
+
 	idtr.base_address = (uint32_t)idt_array;
 	idtr.limit        = sizeof(idt_array) - 1;
 
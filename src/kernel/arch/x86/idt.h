@@ -22,6 +22,8 @@
 
 // Setup the interrupt descriptor table.
 void x86_idt_setup(void);
+// Point the executing CPU at the (shared) interrupt descriptor table.
+void x86_idt_load(void);
 
 /**
  * Set an interrupt handler with a callback.
@@ -7,18 +7,19 @@
 
 section .text
 
-; The address of the table of handlers (defined in irq.c)
-[extern x86_irq_handler_array]
+; Runs the handler registered in irq.c under the kernel lock
+[extern x86_irq_dispatch]
 
 ; The address of the table of wrappers (defined below, and shared with irq.c)
 [global x86_irq_wrapper_array]
 
 ;
-[extern g_pit_ticks]
 [extern g_localApicAddr]
-[global pit_interrupt]
 [global spurious_interrupt_handler]
-[extern timer_interrupt_handler]
+[global lapic_timer_interrupt]
+[extern lapic_timer_interrupt_handler]
+[global reschedule_interrupt]
+[extern reschedule_interrupt_handler]
 
 ; Same packed layout of cpu_state, other irq wrappers (o16)
 %macro SAVE_REGISTERS 0
@@ -66,18 +67,18 @@ section .text
 
 		SAVE_REGISTERS
 
-		; Call the handler with IRQ number as argument
-		push %1
-		lea  edi, [x86_irq_handler_array]
-		call [edi+4*%1]
-		add  esp, 4
-
-		; LAPIC EOI (PIC is masked; IRQs arrive via IOAPIC)
+		; LAPIC EOI (PIC is masked; IRQs arrive via IOAPIC), first
+		; because the handler may switch to another thread
 		mov edi, [g_localApicAddr]
 		add edi, 0xb0
 		xor eax, eax
 		stosd
 
+		; Call the handler with IRQ number as argument
+		push %1
+		call x86_irq_dispatch
+		add  esp, 4
+
 		RESTORE_REGISTERS
 
 		; Remove fake error code
@@ -100,18 +101,18 @@ section .text
 
 		SAVE_REGISTERS
 
-		; Call the handler with IRQ number as argument
-		push %1
-		lea  edi, [x86_irq_handler_array]
-		call [edi+4*%1]
-		add  esp, 4
-
-		; LAPIC EOI (PIC is masked; IRQs arrive via IOAPIC)
+		; LAPIC EOI (PIC is masked; IRQs arrive via IOAPIC), first
+		; because the handler may switch to another thread
 		mov edi, [g_localApicAddr]
 		add edi, 0xb0
 		xor eax, eax
 		stosd
 
+		; Call the handler with IRQ number as argument
+		push %1
+		call x86_irq_dispatch
+		add  esp, 4
+
 		RESTORE_REGISTERS
 
 		; Remove fake error code
@@ -137,27 +138,41 @@ X86_IRQ_WRAPPER_SLAVE  13
 X86_IRQ_WRAPPER_SLAVE  14
 X86_IRQ_WRAPPER_SLAVE  15
 
-; PIT interrupt
-pit_interrupt:
-	; Fake error code + frame, matching the IRQ wrappers
+; Local APIC timer interrupt, the scheduler tick of each processor
+lapic_timer_interrupt:
 	push 0
 	push ebp
 	mov  ebp, esp
 	SAVE_REGISTERS
 
 	mov edi, [g_localApicAddr]
-	add edi, 0xb0 ; Write to the register with offset 0xB0...
-	xor eax, eax  ; ...using the value 0 to signal an end of interrupt.
+	add edi, 0xb0
+	xor eax, eax
 	stosd
 
-	; Call the C handler (argument is unused)
-	push 0
-	call timer_interrupt_handler
+	call lapic_timer_interrupt_handler
+
+	RESTORE_REGISTERS
+
 	add  esp, 4
+	iret
+
+; Reschedule IPI, sent by scheduler_insert_thread() to an idle processor
+reschedule_interrupt:
+	push 0
+	push ebp
+	mov  ebp, esp
+	SAVE_REGISTERS
+
+	mov edi, [g_localApicAddr]
+	add edi, 0xb0
+	xor eax, eax
+	stosd
+
+	call reschedule_interrupt_handler
 
 	RESTORE_REGISTERS
 
-	; Remove fake error code
 	add  esp, 4
 	iret
 
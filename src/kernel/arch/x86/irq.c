@@ -7,18 +7,36 @@
 
 #include <lib/c/string.h>
 #include <lib/status.h>
+#include <process/scheduler.h>
+#include <process/rcu.h>
 
 #include "idt.h"
 #include "irq.h"
+#include "kernel_lock.h"
+#include "percpu.h"
 
 #define X86_IRQ_NUM	16
 
 /* array of IRQ wrappers, defined in irq_wrappers.S */
 extern uint32_t x86_irq_wrapper_array[X86_IRQ_NUM];
 
-/* arrays of IRQ handlers, shared with irq_wrappers.S */
+/* arrays of IRQ handlers, called by x86_irq_dispatch() */
 x86_irq_handler_t x86_irq_handler_array[X86_IRQ_NUM] = { NULL, };
 
+void
+x86_irq_dispatch(int irq_level)
+{
+	rcu_note_qs();
+	kernel_lock();
+	x86_irq_handler_array[irq_level](irq_level);
+
+	// The handler woke up a thread that must run right away
+	if (cpu_current()->need_resched)
+		schedule();
+
+	kernel_unlock();
+}
+
 status_t
 x86_irq_set_routine(uint32_t irq_level, x86_irq_handler_t routine)
 {
@@ -44,3 +44,6 @@ typedef void (*x86_irq_handler_t)(int irq_level);
 status_t x86_irq_set_routine(uint32_t irq_level, x86_irq_handler_t routine);
 
 x86_irq_handler_t x86_irq_get_routine(uint32_t irq_level);
+
+/* Called by the IRQ wrappers: runs the routine under the kernel lock. */
+void x86_irq_dispatch(int irq_level);
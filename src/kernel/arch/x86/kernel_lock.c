@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/c/assert.h>
+#include "kernel_lock.h"
+#include "percpu.h"
+#include "spinlock.h"
+
+#define NO_OWNER	((uint32_t)-1)
+
+static spinlock_t lock = SPINLOCK_INITIALIZER;
+static volatile uint32_t owner = NO_OWNER;
+static uint32_t depth;
+
+void
+kernel_lock(void)
+{
+	uint32_t cpu = cpu_current_index();
+
+	if (owner == cpu)
+	{
+		depth++;
+		return;
+	}
+
+	spin_lock(&lock);
+	owner = cpu;
+	depth = 1;
+}
+
+void
+kernel_unlock(void)
+{
+	assert(owner == cpu_current_index() && depth > 0);
+
+	if (--depth > 0)
+		return;
+
+	owner = NO_OWNER;
+	spin_unlock(&lock);
+}
+
+uint32_t
+kernel_lock_drop(void)
+{
+	uint32_t held;
+
+	if (owner != cpu_current_index())
+		return 0;
+
+	held = depth;
+	depth = 0;
+	owner = NO_OWNER;
+	spin_unlock(&lock);
+
+	return held;
+}
+
+void
+kernel_lock_retake(uint32_t held)
+{
+	if (held == 0)
+		return;
+
+	spin_lock(&lock);
+	owner = cpu_current_index();
+	depth = held;
+}
@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * The kernel lock serializes system calls, interrupt handlers and page
+ * faults across processors: that code was written for a single CPU with
+ * interrupts off and keeps relying on it. User code and the scheduler run
+ * in parallel; the allocators have their own locks.
+ *
+ * It is recursive (a page fault may hit while copying system call
+ * arguments) and must be taken with interrupts disabled.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+
+void kernel_lock(void);
+void kernel_unlock(void);
+
+/*
+ * schedule() lets go of the lock while the thread is switched out and
+ * takes it back, with the same depth, once the thread runs again.
+ */
+uint32_t kernel_lock_drop(void);
+void kernel_lock_retake(uint32_t depth);
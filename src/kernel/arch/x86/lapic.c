@@ -23,6 +23,7 @@
 
 #include <lib/c/stdio.h>
 #include "io-ports.h"
+#include "clock.h"
 #include "mmio.h"
 #include "acpi.h"
 #include "lapic.h"
@@ -91,8 +92,14 @@
 // Destination Field
 #define ICR_DESTINATION_SHIFT           24
 
+// ------------------------------------------------------------------------------------------------
+// LVT Timer
+
+#define TIMER_PERIODIC                  0x00020000
+#define TIMER_MASKED                    0x00010000
+#define TIMER_DIVIDE_BY_16              0x00000003
+
 uint8_t *g_localApicAddr;
-uint32_t g_activeCpuCount;
 
 // ------------------------------------------------------------------------------------------------
 static uint32_t LocalApicIn(uint32_t reg)
@@ -148,3 +155,53 @@ void LocalApicSendStartup(uint32_t apic_id, uint32_t vector)
     while (LocalApicIn(LAPIC_ICRLO) & ICR_SEND_PENDING)
         ;
 }
+
+// ------------------------------------------------------------------------------------------------
+void LocalApicSendIpi(uint32_t apic_id, uint32_t vector)
+{
+    LocalApicOut(LAPIC_ICRHI, apic_id << ICR_DESTINATION_SHIFT);
+
+    LocalApicOut(LAPIC_ICRLO, vector | ICR_FIXED
+        | ICR_PHYSICAL | ICR_ASSERT | ICR_EDGE | ICR_NO_SHORTHAND);
+
+    while (LocalApicIn(LAPIC_ICRLO) & ICR_SEND_PENDING)
+        ;
+}
+
+// ------------------------------------------------------------------------------------------------
+void LocalApicStartTimer(uint32_t vector, uint32_t initialCount)
+{
+    LocalApicOut(LAPIC_TDCR, TIMER_DIVIDE_BY_16);
+    LocalApicOut(LAPIC_TIMER, TIMER_PERIODIC | vector);
+    LocalApicOut(LAPIC_TICR, initialCount);
+}
+
+// ------------------------------------------------------------------------------------------------
+void LocalApicStartOneShot(uint32_t vector, uint32_t count)
+{
+    LocalApicOut(LAPIC_TDCR, TIMER_DIVIDE_BY_16);
+    LocalApicOut(LAPIC_TIMER, vector);
+    LocalApicOut(LAPIC_TICR, count);
+}
+
+// ------------------------------------------------------------------------------------------------
+void LocalApicStopTimer()
+{
+    LocalApicOut(LAPIC_TICR, 0);
+}
+
+// ------------------------------------------------------------------------------------------------
+uint32_t LocalApicMeasureTimer(uint32_t ms)
+{
+    LocalApicOut(LAPIC_TDCR, TIMER_DIVIDE_BY_16);
+    LocalApicOut(LAPIC_TIMER, TIMER_MASKED);
+    LocalApicOut(LAPIC_TICR, 0xffffffff);
+
+    clock_calibration_wait(ms);
+
+    uint32_t elapsed = 0xffffffff - LocalApicIn(LAPIC_TCCR);
+
+    LocalApicOut(LAPIC_TICR, 0);
+
+    return elapsed / ms;
+}
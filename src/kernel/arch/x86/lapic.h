@@ -32,3 +32,14 @@ void LocalApicInit();
 uint32_t LocalApicGetId();
 void LocalApicSendInit(uint32_t apic_id);
 void LocalApicSendStartup(uint32_t apic_id, uint32_t vector);
+void LocalApicSendIpi(uint32_t apic_id, uint32_t vector);
+
+// Raise vector every initialCount ticks of the bus clock divided by 16.
+void LocalApicStartTimer(uint32_t vector, uint32_t initialCount);
+
+// Raise vector once, after count ticks of the bus clock divided by 16.
+void LocalApicStartOneShot(uint32_t vector, uint32_t count);
+void LocalApicStopTimer();
+
+// Timer ticks per millisecond, counted over ms milliseconds, see clock.h.
+uint32_t LocalApicMeasureTimer(uint32_t ms);
@@ -18,6 +18,23 @@
 extern void x86_load_page_directory(uint32_t *);
 extern void x86_enable_paging();
 
+static inline uint32_t
+current_page_directory(void)
+{
+	uint32_t cr3;
+
+	asm volatile("mov %%cr3, %0" : "=r"(cr3));
+	return cr3 & PAGE_FRAME_MASK;
+}
+
+// Drop a stale TLB entry; only needed when pd_physical is live in CR3.
+static inline void
+page_invalidate(uint32_t pd_physical, uint32_t vaddr)
+{
+	if (current_page_directory() == pd_physical)
+		asm volatile("invlpg (%0)" :: "r"(vaddr) : "memory");
+}
+
 uint32_t page_directory[1024] __attribute__((aligned(4096)));
 
 
@@ -121,13 +138,33 @@ page_directory_clone(uint32_t src_pd)
 				continue;
 
 			src_frame = pte & PAGE_FRAME_MASK;
+			vaddr = (i << 22) | (j << 12);
+
+			/* Shared frames (e.g. initrd file pages) are not copied. */
+			if (pte & PAGE_SHARED)
+			{
+				frame_ref(src_frame);
+
+				if (page_map_user(dst_pd, vaddr, src_frame,
+						  pte & PAGE_MASK) != KERNEL_OK)
+				{
+					frame_free(src_frame);
+					goto fail;
+				}
+
+				/* PROT_NONE pages stay out of the child's reach too. */
+				if (!(pte & PAGE_USER))
+					page_protect_user(dst_pd, vaddr, pte & PAGE_RW);
+
+				continue;
+			}
+
 			dst_frame = frame_alloc();
 			if (!dst_frame)
 				goto fail;
 
 			memcpy(PA2VA(dst_frame), PA2VA(src_frame), PAGE_SIZE);
 
-			vaddr = (i << 22) | (j << 12);
 			flags = (pte & PAGE_RW) ? PAGE_RW : 0;
 
 			if (page_map_user(dst_pd, vaddr, dst_frame, flags) != KERNEL_OK)
@@ -135,6 +172,9 @@ page_directory_clone(uint32_t src_pd)
 				frame_free(dst_frame);
 				goto fail;
 			}
+
+			if (!(pte & PAGE_USER))
+				page_protect_user(dst_pd, vaddr, flags);
 		}
 	}
 
@@ -180,6 +220,12 @@ page_map_user(uint32_t pd_physical, uint32_t vaddr, uint32_t paddr, uint32_t fla
 
 	pt[pte_i] = (paddr & PAGE_FRAME_MASK) | (flags & PAGE_MASK) | PAGE_PRESENT | PAGE_USER;
 
+	/* A private page has a single mapping, which makes it movable. */
+	if (!(flags & PAGE_SHARED))
+	{
+		frame_set_owner(paddr, pd_physical, vaddr);
+	}
+
 	return KERNEL_OK;
 }
 
@@ -262,3 +308,79 @@ page_lookup(uint32_t pd_physical, uint32_t vaddr)
 
 	return pt[pte_i] & PAGE_FRAME_MASK; /* page-aligned physical frame */
 }
+
+// Returns the PTE slot of a user page, or NULL if no page table covers it.
+static uint32_t *
+user_pte(uint32_t pd_physical, uint32_t vaddr)
+{
+	uint32_t pde_i = PDE_INDEX(vaddr);
+	uint32_t *pd = (uint32_t *)PA2VA(pd_physical);
+
+	if (pde_i >= KERNEL_PDE_START || !(pd[pde_i] & PAGE_PRESENT)
+	    || (pd[pde_i] & PAGE_PS))
+	{
+		return NULL;
+	}
+
+	return (uint32_t *)PA2VA(pd[pde_i] & PAGE_FRAME_MASK) + PTE_INDEX(vaddr);
+}
+
+uint32_t
+page_unmap_user(uint32_t pd_physical, uint32_t vaddr)
+{
+	uint32_t *pte = user_pte(pd_physical, vaddr);
+	uint32_t frame;
+
+	if (!pte || !(*pte & PAGE_PRESENT))
+	{
+		return 0;
+	}
+
+	frame = *pte & PAGE_FRAME_MASK;
+
+	if (!(*pte & PAGE_SHARED))
+	{
+		frame_set_owner(frame, 0, 0);
+	}
+
+	*pte = 0;
+	page_invalidate(pd_physical, vaddr);
+
+	return frame;                       /* caller drops the reference */
+}
+
+status_t
+page_migrate_user(uint32_t pd_physical, uint32_t vaddr, uint32_t from,
+		uint32_t to)
+{
+	uint32_t *pte = user_pte(pd_physical, vaddr);
+
+	if (!pte || !(*pte & PAGE_PRESENT) || (*pte & PAGE_FRAME_MASK) != from)
+	{
+		return -KERNEL_INVALID_VALUE;
+	}
+
+	memcpy(PA2VA(to), PA2VA(from), PAGE_SIZE);
+	*pte = to | (*pte & PAGE_MASK);
+	page_invalidate(pd_physical, vaddr);
+
+	return KERNEL_OK;
+}
+
+status_t
+page_protect_user(uint32_t pd_physical, uint32_t vaddr, uint32_t flags)
+{
+	uint32_t *pte = user_pte(pd_physical, vaddr);
+
+	if (!pte || !(*pte & PAGE_PRESENT))
+	{
+		return -KERNEL_UNRESOLVED_VIRTUAL_ADDRESS;
+	}
+
+	/* PAGE_USER is taken from flags: clearing it implements PROT_NONE. */
+	*pte = (*pte & (PAGE_FRAME_MASK | PAGE_SHARED))
+		| (flags & (PAGE_RW | PAGE_USER)) | PAGE_PRESENT;
+	page_invalidate(pd_physical, vaddr);
+
+	return KERNEL_OK;
+}
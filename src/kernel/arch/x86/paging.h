@@ -12,6 +12,7 @@
 #define PAGE_RW		0x2
 #define PAGE_USER	(1 << 2)			// U/S bit
 #define PAGE_PS		0x80				// 4MB page
+#define PAGE_SHARED	0x200				// OS bit: frame not private to this PD
 
 void x86_paging_setup(void);
 uint32_t page_directory_create(void);
@@ -21,4 +22,9 @@ void page_directory_switch(uint32_t pd_phys);
 void page_directory_clear_user(uint32_t pd_phys);
 void page_directory_destroy(uint32_t pd_phys);
 uint32_t page_lookup(uint32_t pd_phys, uint32_t vaddr);
+uint32_t page_unmap_user(uint32_t pd_phys, uint32_t vaddr);
+status_t page_protect_user(uint32_t pd_phys, uint32_t vaddr, uint32_t flags);
+// Copy a private user page to frame `to` and repoint its PTE there.
+status_t page_migrate_user(uint32_t pd_phys, uint32_t vaddr, uint32_t from,
+		uint32_t to);
 uint32_t page_directory_kernel(void);
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/c/string.h>
+#include "acpi.h"
+#include "lapic.h"
+#include "percpu.h"
+
+struct cpu cpus[NB_CPUS];
+uint32_t nb_cpus = 1;
+
+void
+percpu_setup(void)
+{
+	uint32_t bsp_id = LocalApicGetId();
+
+	memset(cpus, 0, sizeof(cpus));
+
+	cpus[0].apic_id = bsp_id;
+	cpus[0].online = true;
+
+	// No tick until tick_start()
+	for (uint32_t i = 0; i < NB_CPUS; i++)
+		cpus[i].tick_stopped = true;
+
+	// The bootstrap processor is CPU 0, whatever its place in the MADT
+	for (uint32_t i = 0; i < g_acpiCpuCount && nb_cpus < NB_CPUS; i++)
+	{
+		if (g_acpiCpuIds[i] == bsp_id)
+			continue;
+
+		cpus[nb_cpus].index = nb_cpus;
+		cpus[nb_cpus].apic_id = g_acpiCpuIds[i];
+		nb_cpus++;
+	}
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+#include <lib/c/stdbool.h>
+#include <arch/x86/acpi.h>
+#include <arch/x86/segment.h>
+
+#define NB_CPUS MAX_CPU_COUNT
+
+struct thread;
+
+struct cpu
+{
+	uint32_t	index;
+	uint32_t	apic_id;
+	volatile bool	online;
+	struct thread	*current_thread;
+	struct thread	*idle_thread;	/* runs when nothing else is ready */
+	uint32_t	page_directory;	/* of the running thread, see switch_to */
+	volatile bool	need_resched;	/* schedule() before leaving the kernel */
+	bool		tick_stopped;	/* see tick_stop() */
+	volatile uint32_t rcu_qs;	/* quiescent states, see rcu.h */
+	uint32_t	rcu_nesting;	/* of rcu_read_lock() */
+	uint32_t	rcu_flags;	/* EFLAGS before the outermost one */
+};
+
+extern struct cpu cpus[NB_CPUS];
+extern uint32_t nb_cpus;		/* present, online or not */
+
+/*
+ * Index of the executing CPU, in [0, NB_CPUS). Each CPU loads its own TSS,
+ * so the task register tells them apart without touching the local APIC.
+ * Before tss_setup() it reads 0: only the bootstrap processor runs then.
+ */
+static inline uint32_t
+cpu_current_index(void)
+{
+	uint16_t selector;
+
+	asm volatile("str %0" : "=r"(selector));
+
+	if (selector == 0)
+		return 0;
+
+	return (uint32_t)(selector >> 3) - TSS_SEGMENT;
+}
+
+static inline struct cpu *
+cpu_current(void)
+{
+	return &cpus[cpu_current_index()];
+}
+
+// Register the bootstrap processor and number the others.
+void percpu_setup(void);
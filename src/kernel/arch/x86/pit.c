@@ -9,13 +9,10 @@
 
 #include <lib/status.h>
 #include <arch/x86/io-ports.h>
-#include <arch/x86//irq.h>
-#include <process/scheduler.h>
 
 #include "pit.h"
 
 extern uintptr_t g_localApicAddr;
-volatile uint32_t g_pit_ticks = 0;
 
 /** 82C54's clock's maximal frequency */
 #define MAX_FREQUENCY 1193182
@@ -26,6 +23,9 @@ volatile uint32_t g_pit_ticks = 0;
 #define CHANNEL2  0x42	/* PC speaker */
 #define CONTROL_REGISTER 0x43
 
+/* Reload value of channel 0, 65536 until set_frequency() changes it */
+static uint32_t pit_divisor = 65536;
+
 
 /**
  * "The timer will divide it's input clock of 1.19MHz (1193180Hz)
@@ -54,6 +54,7 @@ x86_pit_set_frequency(uint32_t frequency)
 
 	/* Prevent the divisor value to overflow, because it is coded
 	 * on 16 bits (can't be greater than 65536) */
+	pit_divisor = divisor;
 	if (divisor == 65536)
 		divisor = 0;
 
@@ -71,36 +72,38 @@ x86_pit_set_frequency(uint32_t frequency)
 	return KERNEL_OK;
 }
 
-void
-timer_interrupt_handler(int number)
+static uint32_t
+pit_read_count(void)
 {
-	static int seconds = 0;
-	uint32_t flags;
-
-	(void)number; // Avoid a useless warning ;-)
+	uint8_t low, high;
 
-	g_pit_ticks++;
-
-	if (g_pit_ticks % 100 == 0)
-	{
-		seconds++;
-		g_pit_ticks = 0;
-	}
+	/* Latch channel 0 so both bytes belong to the same count */
+	out8(CONTROL_REGISTER, 0x00);
+	low = in8(CHANNEL0);
+	high = in8(CHANNEL0);
 
-	X86_IRQs_DISABLE(flags);
-	schedule();
-	X86_IRQs_ENABLE(flags);
+	return ((uint32_t)high << 8) | low;
 }
 
+/*
+ * Busy-wait by following the channel 0 count: its interrupt is not routed
+ * anywhere, the PIT only serves to time the TSC and the local APIC timers
+ * without an HPET, and to start the application processors.
+ */
 void
 PitWait(uint32_t ms)
 {
-    uint32_t now = g_pit_ticks;
-    //kprintf("PitWait: now = %d, ms = %d\n", now, ms);
-    ++ms;
-
-    while (g_pit_ticks - now < ms)
-    {
-        ;
-    }
+	uint32_t remaining = ms * (MAX_FREQUENCY / 1000);
+	uint32_t previous = pit_read_count();
+
+	while (remaining > 0)
+	{
+		uint32_t now = pit_read_count();
+		uint32_t elapsed = (now <= previous)
+			? previous - now
+			: previous + pit_divisor - now;	/* reloaded */
+
+		remaining = (elapsed >= remaining) ? 0 : remaining - elapsed;
+		previous = now;
+	}
 }
@@ -21,11 +21,4 @@
  */
 status_t x86_pit_set_frequency(uint32_t frequency);
 
-/**
- * Timer's interrupt handler called periodically
- *
- * @param id
- */
-void timer_interrupt_handler(int number);
-
 void PitWait(uint32_t ms);
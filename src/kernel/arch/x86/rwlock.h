@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Locks for data that is read much more often than it is written.
+ *
+ * rwlock_t lets any number of readers in at once, or a single writer. A
+ * waiting writer holds off new readers, so that a steady flow of them
+ * cannot starve it.
+ *
+ * seqcount_t does not hold readers off at all: they look at the sequence
+ * before and after reading, and start over if a writer came in between.
+ * Writers must be serialized by some other means.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+#include <arch/x86/atomic.h>
+#include <arch/x86/irq.h>
+
+#define RW_WRITER	0x1	/* a writer holds it */
+#define RW_WAITING	0x2	/* a writer waits for the readers to leave */
+#define RW_READER	0x4	/* one reader, counted from bit 2 */
+
+typedef struct rwlock
+{
+	atomic_t	state;
+} rwlock_t;
+
+#define RWLOCK_INITIALIZER	{ ATOMIC_INIT(0) }
+
+static inline void
+rwlock_init(rwlock_t *lock)
+{
+	atomic_set(&lock->state, 0);
+}
+
+static inline void
+read_lock(rwlock_t *lock)
+{
+	for (;;)
+	{
+		int32_t state = atomic_read(&lock->state);
+
+		if (!(state & (RW_WRITER | RW_WAITING))
+		    && atomic_cmpxchg(&lock->state, state, state + RW_READER)
+		    == state)
+			return;
+
+		asm volatile("pause" ::: "memory");
+	}
+}
+
+static inline void
+read_unlock(rwlock_t *lock)
+{
+	atomic_add(&lock->state, -RW_READER);
+}
+
+static inline void
+write_lock(rwlock_t *lock)
+{
+	for (;;)
+	{
+		int32_t state = atomic_read(&lock->state);
+
+		// Neither readers nor writer: take it, clearing RW_WAITING
+		if ((state & ~RW_WAITING) == 0)
+		{
+			if (atomic_cmpxchg(&lock->state, state, RW_WRITER)
+			    == state)
+				return;
+		}
+		else if (!(state & RW_WAITING))
+		{
+			atomic_cmpxchg(&lock->state, state, state | RW_WAITING);
+		}
+
+		asm volatile("pause" ::: "memory");
+	}
+}
+
+static inline void
+write_unlock(rwlock_t *lock)
+{
+	// Another writer may have set RW_WAITING meanwhile: keep it
+	atomic_add(&lock->state, -RW_WRITER);
+}
+
+#define read_lock_irqsave(lock, flags) \
+	({ X86_IRQs_DISABLE(flags); read_lock(lock); })
+
+#define read_unlock_irqrestore(lock, flags) \
+	({ read_unlock(lock); X86_IRQs_ENABLE(flags); })
+
+#define write_lock_irqsave(lock, flags) \
+	({ X86_IRQs_DISABLE(flags); write_lock(lock); })
+
+#define write_unlock_irqrestore(lock, flags) \
+	({ write_unlock(lock); X86_IRQs_ENABLE(flags); })
+
+typedef struct seqcount
+{
+	volatile uint32_t sequence;	/* odd while a writer is at work */
+} seqcount_t;
+
+#define SEQCOUNT_INITIALIZER	{ 0 }
+
+static inline uint32_t
+read_seqbegin(const seqcount_t *s)
+{
+	uint32_t sequence;
+
+	while ((sequence = s->sequence) & 1)
+		asm volatile("pause" ::: "memory");
+
+	barrier();
+	return sequence;
+}
+
+// Whether what was read since read_seqbegin() may be inconsistent.
+static inline bool
+read_seqretry(const seqcount_t *s, uint32_t sequence)
+{
+	barrier();
+	return s->sequence != sequence;
+}
+
+static inline void
+write_seqbegin(seqcount_t *s)
+{
+	s->sequence++;
+	barrier();
+}
+
+static inline void
+write_seqend(seqcount_t *s)
+{
+	barrier();
+	s->sequence++;
+}
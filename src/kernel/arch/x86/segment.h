@@ -12,7 +12,7 @@
 #define KERNEL_DATA_SEGMENT 2
 #define USER_CODE_SEGMENT   3
 #define USER_DATA_SEGMENT   4
-#define TSS_SEGMENT         5
+#define TSS_SEGMENT         5	/* CPU i uses TSS_SEGMENT + i: keep it last */
 
 /*
  * Builds a value for a segment register
@@ -22,49 +22,135 @@
  */
 
 #include <lib/c/stdio.h>
+#include <lib/c/string.h>
+#include <lib/status.h>
+#include <memory/frame.h>
+#include <process/thread.h>
+#include <process/scheduler.h>
+#include <process/timer.h>
+#include <process/rcu.h>
 #include "acpi.h"
+#include "gdt.h"
+#include "idt.h"
 #include "lapic.h"
+#include "paging.h"
+#include "percpu.h"
 #include "pit.h"
 #include "smp.h"
+#include "tick.h"
+
+// Filled in before each STARTUP IPI, see ap-trampoline.asm
+struct ApTrampolineParams
+{
+    uint32_t pageDirectory;
+    uint32_t stack;
+};
+
+extern char ap_trampoline_start[];
+extern char ap_trampoline_params[];
+extern char ap_trampoline_end[];
+extern void reschedule_interrupt();
+
+volatile uint32_t g_activeCpuCount;
+
+// Processors are started one at a time; this is the one coming up
+static volatile uint32_t s_bootingCpu;
 
 // ------------------------------------------------------------------------------------------------
-void SmpInit()
+void lapic_timer_interrupt_handler(void)
 {
-    kprintf("Waking up all CPUs\n");
+    rcu_note_qs();
+    timer_run();
+    scheduler_tick();
+}
 
-    g_activeCpuCount = 1;
-    uint32_t localId = LocalApicGetId();
+// ------------------------------------------------------------------------------------------------
+void reschedule_interrupt_handler(void)
+{
+    schedule();
+}
+
+// ------------------------------------------------------------------------------------------------
+// Entered from the trampoline on the boot stack, with paging on and interrupts off.
+void ap_main()
+{
+    uint32_t cpu = s_bootingCpu;
+
+    x86_gdt_setup();
+    x86_idt_load();
+    tss_setup(cpu);     // cpu_current_index() is valid from here
+    LocalApicInit();
+
+    thread_set_current(cpus[cpu].idle_thread);
+    tick_start();
+
+    cpus[cpu].online = true;
+    ++g_activeCpuCount;
+
+    scheduler_start();
+}
+
+// ------------------------------------------------------------------------------------------------
+static status_t SmpStartCpu(uint32_t cpu, struct ApTrampolineParams *params)
+{
+    uint32_t apicId = cpus[cpu].apic_id;
+    paddr_t stack = frame_alloc();
 
-    // Send Init to all cpus except self
-    for (uint32_t i = 0; i < g_acpiCpuCount; ++i)
+    if (!stack || !thread_idle_create(cpu))
     {
-        uint32_t apicId = g_acpiCpuIds[i];
-        if (apicId != localId)
-        {
-            LocalApicSendInit(apicId);
-        }
+        return -KERNEL_NO_MEMORY;
     }
 
-    // wait
+    params->stack = (uint32_t)PA2VA(stack) + PAGE_SIZE;
+    s_bootingCpu = cpu;
+
+    // INIT, then up to two STARTUP IPIs (MultiProcessor Specification, B.4)
+    LocalApicSendInit(apicId);
     PitWait(10);
 
-    // Send Startup to all cpus except self
-    for (uint32_t i = 0; i < g_acpiCpuCount; ++i)
+    for (uint32_t attempt = 0; attempt < 2 && !cpus[cpu].online; ++attempt)
     {
-        uint32_t apicId = g_acpiCpuIds[i];
-        if (apicId != localId)
+        LocalApicSendStartup(apicId, AP_TRAMPOLINE_BASE >> PAGE_SHIFT);
+
+        for (uint32_t ms = 0; ms < 100 && !cpus[cpu].online; ++ms)
         {
-            LocalApicSendStartup(apicId, 0x8);
+            PitWait(1);
         }
     }
 
-    // Wait for all cpus to be active
-    PitWait(1);
-    while (g_activeCpuCount != g_acpiCpuCount)
+    return cpus[cpu].online ? KERNEL_OK : -KERNEL_NO_SUCH_DEVICE;
+}
+
+// ------------------------------------------------------------------------------------------------
+void SmpInit()
+{
+    uint8_t *trampoline = PA2VA(AP_TRAMPOLINE_BASE);
+    struct ApTrampolineParams *params = (struct ApTrampolineParams *)
+        (trampoline + (ap_trampoline_params - ap_trampoline_start));
+
+    g_activeCpuCount = 1;
+
+    if (nb_cpus == 1)
+    {
+        return;
+    }
+
+    kprintf("Waking up all CPUs\n");
+
+    memcpy(trampoline, ap_trampoline_start,
+        (size_t)(ap_trampoline_end - ap_trampoline_start));
+    params->pageDirectory = page_directory_kernel();
+
+    x86_idt_set_handler(RESCHEDULE_INTERRUPT, (uint32_t)reschedule_interrupt, 0);
+
+    for (uint32_t cpu = 1; cpu < nb_cpus; ++cpu)
     {
-        kprintf("Waiting... %d\n", g_activeCpuCount);
-        PitWait(1);
+        if (SmpStartCpu(cpu, params) != KERNEL_OK)
+        {
+            kprintf("CPU %u (APIC id %u) did not start\n",
+                (unsigned int)cpu, (unsigned int)cpus[cpu].apic_id);
+        }
     }
 
-    kprintf("All CPUs activated\n");
+    kprintf("%u CPUs activated\n", (unsigned int)g_activeCpuCount);
 }
@@ -26,6 +26,17 @@
 
 #include <lib/types.h>
 
-extern volatile uint8_t g_activeCpuCount;
+// Where SmpInit() copies the startup code; keep in sync with ap-trampoline.asm
+#define AP_TRAMPOLINE_BASE              0x8000
+
+// Scheduler tick of every processor, see tick.c
+#define LAPIC_TIMER_INTERRUPT           0x40
+
+// Sent to an idle processor when another one has work to spare
+#define RESCHEDULE_INTERRUPT            0x41
+
+extern volatile uint32_t g_activeCpuCount;
 
 void SmpInit();
+void lapic_timer_interrupt_handler(void);
+void reschedule_interrupt_handler(void);
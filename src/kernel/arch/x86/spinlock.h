@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Busy-waiting locks for data shared between processors.
+ *
+ * spinlock_t is a test-and-test-and-set lock: cheap, but when it is
+ * released every waiter rushes for it and the fastest one wins.
+ * ticket_lock_t serves its waiters in arrival order. mcs_lock_t does too,
+ * and each waiter spins on a node of its own rather than on the lock, so
+ * that a release only touches the cache of the next waiter: it suits the
+ * most contended locks, but nodes cannot change hands, so it must be
+ * released by the thread that took it.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+#include <lib/c/stdbool.h>
+#include <lib/c/string.h>
+#include <arch/x86/irq.h>
+
+typedef struct spinlock
+{
+	volatile uint32_t locked;
+} spinlock_t;
+
+#define SPINLOCK_INITIALIZER	{ 0 }
+
+static inline void
+spinlock_init(spinlock_t *lock)
+{
+	lock->locked = 0;
+}
+
+// Most pauses between two looks at a spinlock_t
+#define SPIN_BACKOFF_MAX	64
+
+// Pauses per waiter ahead, between two looks at a ticket_lock_t
+#define TICKET_BACKOFF		16
+
+static inline void
+cpu_relax(uint32_t pauses)
+{
+	while (pauses-- > 0)
+		asm volatile("pause" ::: "memory");
+}
+
+static inline void
+spin_lock(spinlock_t *lock)
+{
+	uint32_t value = 1;
+	uint32_t backoff = 1;
+
+	for (;;)
+	{
+		asm volatile("xchgl %0, %1"
+			     : "+r"(value), "+m"(lock->locked)
+			     :
+			     : "memory");
+		if (value == 0)
+			return;
+
+		/*
+		 * Spin on a plain read so the cache line stays shared, and
+		 * look less and less often so that waiters spread out.
+		 */
+		while (lock->locked)
+		{
+			cpu_relax(backoff);
+			if (backoff < SPIN_BACKOFF_MAX)
+				backoff <<= 1;
+		}
+	}
+}
+
+static inline void
+spin_unlock(spinlock_t *lock)
+{
+	asm volatile("" ::: "memory");
+	lock->locked = 0;
+}
+
+typedef union ticket_lock
+{
+	volatile uint32_t tickets;
+	struct
+	{
+		volatile uint16_t owner;	/* ticket being served */
+		volatile uint16_t next;		/* ticket of the next comer */
+	};
+} ticket_lock_t;
+
+#define TICKET_LOCK_INITIALIZER	{ 0 }
+
+static inline void
+ticket_lock_init(ticket_lock_t *lock)
+{
+	lock->tickets = 0;
+}
+
+static inline void
+ticket_lock(ticket_lock_t *lock)
+{
+	uint32_t tickets = 1u << 16;
+	uint16_t ticket;
+
+	// Take the next ticket and see who is served, at once
+	asm volatile("lock xaddl %0, %1"
+		     : "+r"(tickets), "+m"(lock->tickets)
+		     :
+		     : "memory");
+
+	ticket = (uint16_t)(tickets >> 16);
+
+	// The further back in the queue, the longer until our turn
+	for (uint16_t owner = (uint16_t)tickets; owner != ticket;
+	     owner = lock->owner)
+		cpu_relax((uint16_t)(ticket - owner) * TICKET_BACKOFF);
+}
+
+static inline void
+ticket_unlock(ticket_lock_t *lock)
+{
+	// Only the holder writes owner: no need for a locked instruction
+	asm volatile("incw %0" : "+m"(lock->owner) :: "memory", "cc");
+}
+
+struct mcs_node
+{
+	struct mcs_node * volatile next;
+	volatile bool	waiting;
+};
+
+typedef struct mcs_lock
+{
+	struct mcs_node * volatile tail;	/* last comer */
+} mcs_lock_t;
+
+#define MCS_LOCK_INITIALIZER	{ NULL }
+
+static inline void
+mcs_lock_init(mcs_lock_t *lock)
+{
+	lock->tail = NULL;
+}
+
+// node stands for the caller in the queue until mcs_unlock().
+static inline void
+mcs_lock(mcs_lock_t *lock, struct mcs_node *node)
+{
+	struct mcs_node *prev = node;
+
+	node->next = NULL;
+	node->waiting = true;
+
+	asm volatile("xchgl %0, %1"
+		     : "+r"(prev), "+m"(lock->tail)
+		     :
+		     : "memory");
+	if (!prev)
+		return;
+
+	prev->next = node;
+
+	while (node->waiting)
+		asm volatile("pause" ::: "memory");
+}
+
+static inline void
+mcs_unlock(mcs_lock_t *lock, struct mcs_node *node)
+{
+	if (!node->next)
+	{
+		struct mcs_node *tail = node;
+
+		// Nobody queued behind us: empty the queue
+		asm volatile("lock cmpxchgl %2, %1"
+			     : "+a"(tail), "+m"(lock->tail)
+			     : "r"((struct mcs_node *)NULL)
+			     : "memory");
+		if (tail == node)
+			return;
+
+		// Somebody is: wait for it to link itself
+		while (!node->next)
+			asm volatile("pause" ::: "memory");
+	}
+
+	node->next->waiting = false;
+}
+
+/*
+ * A lock also taken from interrupt handlers must be held with interrupts
+ * off, or the handler would spin forever on the processor that owns it.
+ */
+#define spin_lock_irqsave(lock, flags) \
+	({ X86_IRQs_DISABLE(flags); spin_lock(lock); })
+
+#define spin_unlock_irqrestore(lock, flags) \
+	({ spin_unlock(lock); X86_IRQs_ENABLE(flags); })
+
+#define ticket_lock_irqsave(lock, flags) \
+	({ X86_IRQs_DISABLE(flags); ticket_lock(lock); })
+
+#define ticket_unlock_irqrestore(lock, flags) \
+	({ ticket_unlock(lock); X86_IRQs_ENABLE(flags); })
+
+#define mcs_lock_irqsave(lock, node, flags) \
+	({ X86_IRQs_DISABLE(flags); mcs_lock(lock, node); })
+
+#define mcs_unlock_irqrestore(lock, node, flags) \
+	({ mcs_unlock(lock, node); X86_IRQs_ENABLE(flags); })
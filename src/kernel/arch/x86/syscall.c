@@ -10,14 +10,25 @@
 #include <lib/status.h>
 #include <fs/vfs.h>
 #include <memory/frame.h>
+#include <memory/heap.h>
+#include <memory/pool.h>
+#include <memory/heap_profile.h>
 #include <process/process.h>
 #include <process/thread.h>
+#include <process/scheduler.h>
+#include <process/timer.h>
+#include <process/rcu.h>
+#include <process/futex.h>
+#include <process/pi_mutex.h>
 #include <drivers/vbe.h>
 #include <drivers/ps2_keyboard.h>
 #include <fs/commands.h>
 #include "idt.h"
 #include "paging.h"
 #include "acpi.h"
+#include "kernel_lock.h"
+#include "percpu.h"
+#include "clock.h"
 #include "syscall.h"
 
 #define SYSCALL_INTERRUPT 0x80
@@ -29,6 +40,20 @@
 #define READ_MAX	4096
 #define FS_PATH_MAX	256
 
+/*
+ * One write() to the console comes out in one piece. System calls run
+ * under the kernel lock, and writes do not sleep: until that changes,
+ * nobody waits for console_lock.
+ */
+static pi_mutex_t console_lock = PI_MUTEX_INITIALIZER(console_lock);
+
+/*
+ * One read() from the console gets its characters in a row. Its holder
+ * sleeps for the keyboard: a more urgent reader lends it its priority, not
+ * to be held off behind a less urgent thread once the keys come.
+ */
+static pi_mutex_t console_read_lock = PI_MUTEX_INITIALIZER(console_read_lock);
+
 extern struct superblock *root_fs;
 
 // A system call handler receives the saved user frame and returns a value
@@ -36,14 +61,10 @@ extern struct superblock *root_fs;
 typedef uint32_t (*syscall_t)(struct syscall_frame *frame);
 
 static int
-copy_user_byte(uint32_t pd, uint32_t uaddr, uint8_t *out)
+copy_user_byte(process_t *p, uint32_t uaddr, uint8_t *out)
 {
-	uint32_t frame;
+	paddr_t frame = vm_user_frame(p, uaddr, false);
 
-	if (uaddr >= KERNEL_VIRTUAL_BASE)
-		return -1;
-
-	frame = page_lookup(pd, uaddr);
 	if (!frame)
 		return -1;
 
@@ -52,14 +73,10 @@ copy_user_byte(uint32_t pd, uint32_t uaddr, uint8_t *out)
 }
 
 static int
-write_user_byte(uint32_t pd, uint32_t uaddr, uint8_t value)
+write_user_byte(process_t *p, uint32_t uaddr, uint8_t value)
 {
-	uint32_t frame;
-
-	if (uaddr >= KERNEL_VIRTUAL_BASE)
-		return -1;
+	paddr_t frame = vm_user_frame(p, uaddr, true);
 
-	frame = page_lookup(pd, uaddr);
 	if (!frame)
 		return -1;
 
@@ -68,7 +85,7 @@ write_user_byte(uint32_t pd, uint32_t uaddr, uint8_t value)
 }
 
 static int
-copy_user_string(uint32_t pd, uint32_t uaddr, char *dst, size_t maxlen)
+copy_user_string(process_t *p, uint32_t uaddr, char *dst, size_t maxlen)
 {
 	size_t i;
 
@@ -79,7 +96,7 @@ copy_user_string(uint32_t pd, uint32_t uaddr, char *dst, size_t maxlen)
 	{
 		uint8_t b;
 
-		if (copy_user_byte(pd, uaddr + i, &b) != 0)
+		if (copy_user_byte(p, uaddr + i, &b) != 0)
 			return -1;
 
 		dst[i] = (char)b;
@@ -91,7 +108,7 @@ copy_user_string(uint32_t pd, uint32_t uaddr, char *dst, size_t maxlen)
 }
 
 static int
-copy_user_u32(uint32_t pd, uint32_t uaddr, uint32_t *out)
+copy_user_u32(process_t *p, uint32_t uaddr, uint32_t *out)
 {
 	uint32_t value = 0;
 
@@ -99,7 +116,7 @@ copy_user_u32(uint32_t pd, uint32_t uaddr, uint32_t *out)
 	{
 		uint8_t b;
 
-		if (copy_user_byte(pd, uaddr + i, &b) != 0)
+		if (copy_user_byte(p, uaddr + i, &b) != 0)
 			return -1;
 
 		value |= (uint32_t)b << (i * 8);
@@ -110,11 +127,11 @@ copy_user_u32(uint32_t pd, uint32_t uaddr, uint32_t *out)
 }
 
 static int
-write_user_u32(uint32_t pd, uint32_t uaddr, uint32_t value)
+write_user_u32(process_t *p, uint32_t uaddr, uint32_t value)
 {
 	for (size_t i = 0; i < sizeof(uint32_t); i++)
 	{
-		if (write_user_byte(pd, uaddr + i,
+		if (write_user_byte(p, uaddr + i,
 				    (uint8_t)(value >> (i * 8))) != 0)
 			return -1;
 	}
@@ -122,6 +139,34 @@ write_user_u32(uint32_t pd, uint32_t uaddr, uint32_t value)
 	return 0;
 }
 
+static int
+copy_to_user(process_t *p, uint32_t uaddr, const void *src, size_t len)
+{
+	const uint8_t *bytes = src;
+
+	for (size_t i = 0; i < len; i++)
+	{
+		if (write_user_byte(p, uaddr + i, bytes[i]) != 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static int
+copy_from_user(process_t *p, void *dst, uint32_t uaddr, size_t len)
+{
+	uint8_t *bytes = dst;
+
+	for (size_t i = 0; i < len; i++)
+	{
+		if (copy_user_byte(p, uaddr + i, &bytes[i]) != 0)
+			return -1;
+	}
+
+	return 0;
+}
+
 static uint32_t
 sys_exit(struct syscall_frame *frame)
 {
@@ -152,17 +197,21 @@ sys_write(struct syscall_frame *frame)
 	if (!buf || len > WRITE_MAX)
 		return (uint32_t)-1;
 
+	pi_mutex_lock(&console_lock);
+
 	for (i = 0; i < len; i++)
 	{
 		uint8_t c;
 
-		if (copy_user_byte(p->page_directory, buf + i, &c) != 0)
-			return (uint32_t)-1;
+		if (copy_user_byte(p, buf + i, &c) != 0)
+			break;
 
 		vbe_draw_character((char)c);
 	}
 
-	return len;
+	pi_mutex_unlock(&console_lock);
+
+	return i == len ? len : (uint32_t)-1;
 }
 
 static uint32_t
@@ -186,16 +235,20 @@ sys_read(struct syscall_frame *frame)
 	if (!buf || len > READ_MAX)
 		return (uint32_t)-1;
 
+	pi_mutex_lock(&console_read_lock);
+
 	for (i = 0; i < len; i++)
 	{
 		uint8_t c;
 
 		keyboard_read(&c, 1);
-		if (write_user_byte(p->page_directory, buf + i, c) != 0)
-			return (uint32_t)-1;
+		if (write_user_byte(p, buf + i, c) != 0)
+			break;
 	}
 
-	return len;
+	pi_mutex_unlock(&console_read_lock);
+
+	return i == len ? len : (uint32_t)-1;
 }
 
 static uint32_t
@@ -211,7 +264,43 @@ sys_wait(struct syscall_frame *frame)
 	pid = process_wait(p, &status);
 
 	if (pid >= 0 && frame->ebx != 0
-	    && write_user_u32(p->page_directory, frame->ebx,
+	    && write_user_u32(p, frame->ebx,
+			      (uint32_t)status) != 0)
+		return (uint32_t)-1;
+
+	return (uint32_t)pid;
+}
+
+// ebx: pid, or -1 for any child; ecx: status; edx: struct timespec, or 0.
+static uint32_t
+sys_waitpid(struct syscall_frame *frame)
+{
+	process_t *p = thread_get_current()->process;
+	struct timespec ts = { 0, 0 };
+	uint64_t timeout_ns = 0;
+	int status = 0;
+	int pid;
+
+	if (!p)
+		return (uint32_t)-1;
+
+	if (frame->edx != 0)
+	{
+		if (copy_from_user(p, &ts, frame->edx, sizeof(ts)) != 0
+		    || ts.tv_nsec >= NSEC_PER_SEC)
+			return (uint32_t)-1;
+
+		timeout_ns = (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+
+		// A zero delay polls: make it the shortest one there is
+		if (timeout_ns == 0)
+			timeout_ns = 1;
+	}
+
+	pid = process_wait_timeout(p, (int)frame->ebx, &status, timeout_ns);
+
+	if (pid > 0 && frame->ecx != 0
+	    && write_user_u32(p, frame->ecx,
 			      (uint32_t)status) != 0)
 		return (uint32_t)-1;
 
@@ -222,7 +311,6 @@ static uint32_t
 sys_exec(struct syscall_frame *frame)
 {
 	process_t *p = thread_get_current()->process;
-	uint32_t pd;
 	char path[EXEC_PATH_MAX];
 	char arg_storage[EXEC_ARG_MAX][EXEC_ARG_LEN];
 	char *argv[EXEC_ARG_MAX + 1];
@@ -234,9 +322,7 @@ sys_exec(struct syscall_frame *frame)
 	if (!p || !p->page_directory || !root_fs || !root_fs->root)
 		return (uint32_t)-1;
 
-	pd = p->page_directory;
-
-	if (copy_user_string(pd, frame->ebx, path, sizeof(path)) != 0)
+	if (copy_user_string(p, frame->ebx, path, sizeof(path)) != 0)
 		return (uint32_t)-1;
 
 	uargv = frame->ecx;
@@ -245,14 +331,14 @@ sys_exec(struct syscall_frame *frame)
 
 	for (argc = 0; argc < EXEC_ARG_MAX; argc++)
 	{
-		if (copy_user_u32(pd, uargv + (uint32_t)argc * sizeof(uint32_t),
+		if (copy_user_u32(p, uargv + (uint32_t)argc * sizeof(uint32_t),
 				  &uarg) != 0)
 			return (uint32_t)-1;
 
 		if (uarg == 0)
 			break;
 
-		if (copy_user_string(pd, uarg, arg_storage[argc], EXEC_ARG_LEN) != 0)
+		if (copy_user_string(p, uarg, arg_storage[argc], EXEC_ARG_LEN) != 0)
 			return (uint32_t)-1;
 
 		argv[argc] = arg_storage[argc];
@@ -261,7 +347,7 @@ sys_exec(struct syscall_frame *frame)
 	if (argc == EXEC_ARG_MAX)
 	{
 		/* Require a NULL terminator within the limit. */
-		if (copy_user_u32(pd, uargv + (uint32_t)argc * sizeof(uint32_t),
+		if (copy_user_u32(p, uargv + (uint32_t)argc * sizeof(uint32_t),
 				  &uarg) != 0 || uarg != 0)
 			return (uint32_t)-1;
 	}
@@ -402,7 +488,7 @@ sys_fs(struct syscall_frame *frame)
 
 	if (uarg1)
 	{
-		if (copy_user_string(p->page_directory, uarg1, path1,
+		if (copy_user_string(p, uarg1, path1,
 				    sizeof(path1)) != 0)
 		{
 			return (uint32_t)-1;
@@ -413,7 +499,7 @@ sys_fs(struct syscall_frame *frame)
 
 	if (uarg2)
 	{
-		if (copy_user_string(p->page_directory, uarg2, path2,
+		if (copy_user_string(p, uarg2, path2,
 				    sizeof(path2)) != 0)
 		{
 			return (uint32_t)-1;
@@ -454,16 +540,266 @@ sys_reboot(struct syscall_frame *frame)
 	return 0;
 }
 
+static uint32_t
+sys_mmap(struct syscall_frame *frame)
+{
+	process_t *p = thread_get_current()->process;
+	uint32_t words[sizeof(struct mmap_args) / sizeof(uint32_t)];
+	struct mmap_args args;
+	char path[FS_PATH_MAX];
+	struct node *file = NULL;
+	uint32_t addr;
+
+	if (!p || !root_fs || !root_fs->root)
+		return (uint32_t)-1;
+
+	for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++)
+	{
+		if (copy_user_u32(p, frame->ebx + i * sizeof(uint32_t),
+				  &words[i]) != 0)
+			return (uint32_t)-1;
+	}
+
+	memcpy(&args, words, sizeof(args));
+
+	if (!(args.flags & MAP_ANONYMOUS))
+	{
+		if (!args.path
+		    || copy_user_string(p, args.path, path, sizeof(path)) != 0)
+			return (uint32_t)-1;
+
+		file = resolve_node(path,
+				    path[0] == '/' ? root_fs->root : p->cwd);
+		if (!file)
+			return (uint32_t)-1;
+	}
+
+	addr = vm_mmap(p, args.addr, args.length, args.prot, args.flags,
+		       file, args.offset);
+
+	return addr ? addr : (uint32_t)-1;
+}
+
+static uint32_t
+sys_munmap(struct syscall_frame *frame)
+{
+	process_t *p = thread_get_current()->process;
+
+	if (!p)
+		return (uint32_t)-1;
+
+	return (uint32_t)vm_munmap(p, frame->ebx, frame->ecx);
+}
+
+static uint32_t
+sys_mprotect(struct syscall_frame *frame)
+{
+	process_t *p = thread_get_current()->process;
+
+	if (!p)
+		return (uint32_t)-1;
+
+	return (uint32_t)vm_mprotect(p, frame->ebx, frame->ecx, frame->edx);
+}
+
+static uint32_t
+sys_memstat(struct syscall_frame *frame)
+{
+	process_t *p = thread_get_current()->process;
+	union
+	{
+		struct frame_stats frames;
+		struct heap_stats heap;
+		struct pool_stats pool;
+	} stats;
+	size_t size;
+
+	if (frame->ebx == MEMSTAT_PROFILE)
+		return heap_profile_report() == KERNEL_OK ? 0 : (uint32_t)-1;
+
+	if (!p || !frame->edx)
+		return (uint32_t)-1;
+
+	switch (frame->ebx)
+	{
+		case MEMSTAT_FRAMES:
+			frame_get_stats(&stats.frames);
+			size = sizeof(stats.frames);
+			break;
+
+		case MEMSTAT_HEAP:
+			heap_get_stats(&stats.heap);
+			size = sizeof(stats.heap);
+			break;
+
+		case MEMSTAT_POOL:
+			if (pool_get_stats(frame->ecx, &stats.pool) != KERNEL_OK)
+				return (uint32_t)-1;
+			size = sizeof(stats.pool);
+			break;
+
+		default:
+			return (uint32_t)-1;
+	}
+
+	if (copy_to_user(p, frame->edx, &stats, size) != 0)
+		return (uint32_t)-1;
+
+	return (uint32_t)size;
+}
+
+// ebx: pid, 0 for the caller; ecx: mask of the CPUs it may run on.
+static uint32_t
+sys_sched_setaffinity(struct syscall_frame *frame)
+{
+	process_t *p = frame->ebx ? process_find((int)frame->ebx)
+		: thread_get_current()->process;
+
+	if (!p || !p->thread)
+		return (uint32_t)-1;
+
+	if (scheduler_set_affinity(p->thread, frame->ecx) != KERNEL_OK)
+		return (uint32_t)-1;
+
+	return 0;
+}
+
+// ebx: pid, 0 for the caller; ecx: nice value, the lower the more favoured.
+static uint32_t
+sys_setnice(struct syscall_frame *frame)
+{
+	process_t *p = frame->ebx ? process_find((int)frame->ebx)
+		: thread_get_current()->process;
+
+	if (!p || !p->thread)
+		return (uint32_t)-1;
+
+	if (pi_set_nice(p->thread, (int)frame->ecx) != KERNEL_OK)
+		return (uint32_t)-1;
+
+	return 0;
+}
+
+// ebx: pid, 0 for the caller; ecx: SCHED_* policy; edx: real-time priority.
+static uint32_t
+sys_sched_setscheduler(struct syscall_frame *frame)
+{
+	process_t *p = frame->ebx ? process_find((int)frame->ebx)
+		: thread_get_current()->process;
+
+	if (!p || !p->thread)
+		return (uint32_t)-1;
+
+	if (pi_set_policy(p->thread, frame->ecx, frame->edx) != KERNEL_OK)
+		return (uint32_t)-1;
+
+	return 0;
+}
+
+// ebx: clock, CLOCK_MONOTONIC only; ecx: the struct timespec to fill in.
+static uint32_t
+sys_clock_gettime(struct syscall_frame *frame)
+{
+	process_t *p = thread_get_current()->process;
+	struct timespec ts;
+
+	if (!p || frame->ebx != CLOCK_MONOTONIC)
+		return (uint32_t)-1;
+
+	clock_monotonic(&ts);
+
+	if (copy_to_user(p, frame->ecx, &ts, sizeof(ts)) != 0)
+		return (uint32_t)-1;
+
+	return 0;
+}
+
+// ebx: struct timespec of the time to sleep.
+static uint32_t
+sys_nanosleep(struct syscall_frame *frame)
+{
+	process_t *p = thread_get_current()->process;
+	struct timespec ts;
+
+	if (!p || copy_from_user(p, &ts, frame->ebx, sizeof(ts)) != 0
+	    || ts.tv_nsec >= NSEC_PER_SEC)
+		return (uint32_t)-1;
+
+	timer_sleep((uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec);
+
+	return 0;
+}
+
+/*
+ * ebx: the futex word; ecx: operation; edx: value or count; esi and edi:
+ * see FUTEX_*. Waits return 0, wakes the number of threads woken up.
+ */
+static uint32_t
+sys_futex(struct syscall_frame *frame)
+{
+	process_t *p = thread_get_current()->process;
+	struct timespec ts;
+	uint64_t timeout_ns = 0;
+	int ret;
+
+	if (!p)
+		return (uint32_t)-1;
+
+	switch (frame->ecx)
+	{
+	case FUTEX_WAIT:
+		if (frame->esi != 0)
+		{
+			if (copy_from_user(p, &ts, frame->esi, sizeof(ts)) != 0
+			    || ts.tv_nsec >= NSEC_PER_SEC)
+				return (uint32_t)-1;
+
+			timeout_ns = (uint64_t)ts.tv_sec * NSEC_PER_SEC
+				+ ts.tv_nsec;
+			if (timeout_ns == 0)
+				timeout_ns = 1;
+		}
+
+		ret = futex_wait(p, frame->ebx, frame->edx, timeout_ns);
+		break;
+
+	case FUTEX_WAKE:
+		ret = futex_wake(p, frame->ebx, frame->edx);
+		break;
+
+	case FUTEX_REQUEUE:
+		ret = futex_requeue(p, frame->ebx, frame->edx, frame->edi,
+				    frame->esi);
+		break;
+
+	default:
+		return (uint32_t)-1;
+	}
+
+	return ret < 0 ? (uint32_t)-1 : (uint32_t)ret;
+}
+
 static syscall_t syscall_table[] = {
-	[SYS_EXIT]   = sys_exit,
-	[SYS_WRITE]  = sys_write,
-	[SYS_WAIT]   = sys_wait,
-	[SYS_EXEC]   = sys_exec,
-	[SYS_READ]   = sys_read,
-	[SYS_FORK]   = sys_fork,
-	[SYS_FS]     = sys_fs,
-	[SYS_HALT]   = sys_halt,
-	[SYS_REBOOT] = sys_reboot,
+	[SYS_EXIT]     = sys_exit,
+	[SYS_WRITE]    = sys_write,
+	[SYS_WAIT]     = sys_wait,
+	[SYS_EXEC]     = sys_exec,
+	[SYS_READ]     = sys_read,
+	[SYS_FORK]     = sys_fork,
+	[SYS_FS]       = sys_fs,
+	[SYS_HALT]     = sys_halt,
+	[SYS_REBOOT]   = sys_reboot,
+	[SYS_MMAP]     = sys_mmap,
+	[SYS_MUNMAP]   = sys_munmap,
+	[SYS_MPROTECT] = sys_mprotect,
+	[SYS_MEMSTAT]  = sys_memstat,
+	[SYS_SCHED_SETAFFINITY] = sys_sched_setaffinity,
+	[SYS_SETNICE]  = sys_setnice,
+	[SYS_SCHED_SETSCHEDULER] = sys_sched_setscheduler,
+	[SYS_CLOCK_GETTIME] = sys_clock_gettime,
+	[SYS_NANOSLEEP] = sys_nanosleep,
+	[SYS_WAITPID]  = sys_waitpid,
+	[SYS_FUTEX]    = sys_futex,
 };
 
 #define SYSCALL_COUNT (sizeof(syscall_table) / sizeof(syscall_table[0]))
@@ -473,6 +809,9 @@ syscall_dispatch(struct syscall_frame *frame)
 {
 	uint32_t number = frame->eax;
 
+	rcu_note_qs();
+	kernel_lock();
+
 	if (number < SYSCALL_COUNT && syscall_table[number] != NULL)
 	{
 		frame->eax = syscall_table[number](frame);
@@ -482,6 +821,11 @@ syscall_dispatch(struct syscall_frame *frame)
 		kprintf("Unknown syscall: %d\n", (int)number);
 		frame->eax = (uint32_t)-1;
 	}
+
+	if (cpu_current()->need_resched)
+		schedule();
+
+	kernel_unlock();
 }
 
 void
@@ -19,6 +19,17 @@
 #define SYS_FS		6
 #define SYS_HALT	7
 #define SYS_REBOOT	8
+#define SYS_MMAP	9
+#define SYS_MUNMAP	10
+#define SYS_MPROTECT	11
+#define SYS_MEMSTAT	12
+#define SYS_SCHED_SETAFFINITY	13
+#define SYS_SETNICE	14
+#define SYS_SCHED_SETSCHEDULER	15
+#define SYS_CLOCK_GETTIME	16
+#define SYS_NANOSLEEP	17
+#define SYS_WAITPID	18
+#define SYS_FUTEX	19
 
 /* SYS_FS opcodes (ebx) */
 #define FS_LS		0
@@ -33,6 +44,20 @@
 #define FS_MV		9
 #define FS_CP		10
 
+/* SYS_MEMSTAT sources (ebx); ecx selects the pool, edx is the buffer */
+#define MEMSTAT_FRAMES	0	/* struct frame_stats */
+#define MEMSTAT_HEAP	1	/* struct heap_stats */
+#define MEMSTAT_POOL	2	/* struct pool_stats */
+#define MEMSTAT_PROFILE	3	/* heap profile, printed on the console */
+
+/* SYS_CLOCK_GETTIME clocks (ebx); ecx is a struct timespec */
+#define CLOCK_MONOTONIC	1	/* since boot */
+
+/* SYS_FUTEX operations (ecx) */
+#define FUTEX_WAIT	0	/* sleep while *ebx == edx; esi: timespec or 0 */
+#define FUTEX_WAKE	1	/* wake up edx sleepers */
+#define FUTEX_REQUEUE	2	/* wake up edx, move esi to edi */
+
 /**
  * Register state as saved by syscall_stub (see syscall-entry.asm).
  *
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/types.h>
+#include <lib/div64.h>
+#include <lib/c/stdio.h>
+#include <arch/x86/percpu.h>
+#include <arch/x86/lapic.h>
+#include <arch/x86/smp.h>
+#include <arch/x86/clock.h>
+#include <arch/x86/hpet.h>
+
+#include "tick.h"
+
+#define CALIBRATION_MS	10
+
+#define NSEC_PER_TICK	(NSEC_PER_SEC / TICK_HZ)
+
+// Local APIC timer ticks per millisecond; the same bus clock drives all CPUs
+static uint32_t lapic_timer_khz;
+
+// Ticks come from HPET timer 0, to the CPU that IRQ0 is routed to
+static bool hpet_tick;
+
+void
+tick_setup(void)
+{
+	lapic_timer_khz = LocalApicMeasureTimer(CALIBRATION_MS);
+
+	kprintf("LAPIC timer: %u kHz\n", (unsigned int)lapic_timer_khz);
+
+	if (lapic_timer_khz == 0 && hpet_has_events())
+	{
+		kprintf("LAPIC timer unusable: ticking on the HPET\n");
+		hpet_tick = true;
+	}
+}
+
+// One-shot HPET events, armed again at each tick while it runs.
+static void
+hpet_tick_handler(void)
+{
+	if (!cpu_current()->tick_stopped)
+		hpet_event_set(NSEC_PER_TICK, hpet_tick_handler);
+
+	lapic_timer_interrupt_handler();
+}
+
+// A tick after the given number of periods, none if 0.
+static void
+hpet_tick_after(uint32_t periods)
+{
+	// Only the CPU that receives IRQ0 may have a tick
+	if (cpu_current_index() != 0)
+		return;
+
+	if (periods == 0)
+		hpet_event_cancel();
+	else
+		hpet_event_set(periods < HPET_EVENT_MAX_NS / NSEC_PER_TICK
+			       ? periods * NSEC_PER_TICK : HPET_EVENT_MAX_NS,
+			       hpet_tick_handler);
+}
+
+static uint32_t
+period_count(void)
+{
+	return lapic_timer_khz * (1000 / TICK_HZ);
+}
+
+void
+tick_start(void)
+{
+	struct cpu *cpu = cpu_current();
+
+	if (!cpu->tick_stopped)
+		return;
+
+	cpu->tick_stopped = false;
+
+	if (hpet_tick)
+		hpet_tick_after(1);
+	else
+		LocalApicStartTimer(LAPIC_TIMER_INTERRUPT, period_count());
+}
+
+void
+tick_stop(uint32_t periods)
+{
+	cpu_current()->tick_stopped = true;
+
+	if (hpet_tick)
+		hpet_tick_after(periods);
+	else if (periods == 0)
+		LocalApicStopTimer();
+	else
+		LocalApicStartOneShot(LAPIC_TIMER_INTERRUPT,
+				      periods < 0xFFFFFFFF / period_count()
+				      ? periods * period_count()
+				      : 0xFFFFFFFF);
+}
+
+uint32_t
+tick_count(void)
+{
+	return (uint32_t)div64_u32(clock_monotonic_ns(), NSEC_PER_SEC / TICK_HZ,
+				   NULL);
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Scheduler tick of each CPU, raised by its own local APIC timer. Should
+ * that fail to calibrate, HPET timer 0 ticks instead, for the processor
+ * that receives IRQ0 alone.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+
+#define TICK_HZ 100
+
+// Measure the local APIC timer frequency, or fall back to the HPET.
+void tick_setup(void);
+
+// Tick periodically on the executing CPU, if it does not already.
+void tick_start(void);
+
+/*
+ * Stop the periodic tick of the executing CPU. A single tick still comes
+ * after the given number of periods, if not 0. Interrupts must be off.
+ */
+void tick_stop(uint32_t periods);
+
+// Ticks since boot by the monotonic clock, whether they were raised or not.
+uint32_t tick_count(void);
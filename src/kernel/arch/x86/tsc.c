@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/div64.h>
+#include <lib/c/stdio.h>
+#include "clock.h"
+#include "tsc.h"
+
+#define CALIBRATION_MS	10
+
+#define CPUID_EXTENDED		0x80000000
+#define CPUID_POWER_MANAGEMENT	0x80000007
+#define CPUID_INVARIANT_TSC	(1 << 8)	/* edx */
+
+uint32_t tsc_khz;
+bool tsc_invariant;
+
+// Nanoseconds since tsc_start are (cycles * ns_mult) >> ns_shift
+static uint64_t tsc_start;
+static uint32_t ns_mult;
+static uint32_t ns_shift;
+
+static void
+cpuid(uint32_t leaf, uint32_t *eax, uint32_t *edx)
+{
+	uint32_t ebx, ecx;
+
+	asm volatile("cpuid"
+		: "=a"(*eax), "=b"(ebx), "=c"(ecx), "=d"(*edx)
+		: "a"(leaf), "c"(0));
+}
+
+static bool
+invariant(void)
+{
+	uint32_t max, edx;
+
+	cpuid(CPUID_EXTENDED, &max, &edx);
+	if (max < CPUID_POWER_MANAGEMENT)
+		return false;
+
+	cpuid(CPUID_POWER_MANAGEMENT, &max, &edx);
+
+	return (edx & CPUID_INVARIANT_TSC) != 0;
+}
+
+void
+tsc_setup(void)
+{
+	uint64_t start = rdtsc();
+
+	clock_calibration_wait(CALIBRATION_MS);
+
+	// Fits in 32 bits below 400 GHz, and there is no 64-bit division
+	tsc_khz = (uint32_t)(rdtsc() - start) / CALIBRATION_MS;
+	tsc_invariant = invariant();
+
+	mult_shift(1000000, tsc_khz, &ns_mult, &ns_shift);
+
+	tsc_start = start;
+
+	kprintf("TSC: %u kHz%s\n", (unsigned int)tsc_khz,
+		tsc_invariant ? ", invariant" : "");
+}
+
+uint64_t
+tsc_ns(void)
+{
+	return mul64_u32_shr(rdtsc() - tsc_start, ns_mult, ns_shift);
+}
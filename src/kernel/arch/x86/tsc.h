@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Time Stamp Counter.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+#include <lib/c/stdbool.h>
+
+// TSC ticks per millisecond, known after tsc_setup().
+extern uint32_t tsc_khz;
+
+// Whether the TSC keeps its rate through frequency and sleep state changes.
+extern bool tsc_invariant;
+
+static inline uint64_t
+rdtsc(void)
+{
+	uint32_t low, high;
+
+	asm volatile("rdtsc" : "=a"(low), "=d"(high));
+	return ((uint64_t)high << 32) | low;
+}
+
+// Measure the TSC frequency, see clock_calibration_wait().
+void tsc_setup(void);
+
+/*
+ * Nanoseconds since tsc_setup(). The TSCs of all processors are assumed
+ * to be in step, as they are when they come out of the same reset.
+ */
+uint64_t tsc_ns(void);
@@ -10,7 +10,7 @@
 
 void *malloc(size_t size)
 {
-	return heap_alloc(size);
+	return heap_alloc_from(size, __builtin_return_address(0));
 }
 
 void free(void *address)
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * 64-bit arithmetic the compiler would otherwise take from libgcc, which
+ * the kernel is not linked with.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+#include <lib/c/string.h>
+
+// n / d, the remainder going to *rem unless it is NULL.
+static inline uint64_t
+div64_u32(uint64_t n, uint32_t d, uint32_t *rem)
+{
+	uint32_t high = (uint32_t)(n >> 32);
+	uint32_t q_high = high / d;
+	uint32_t r = high % d;
+	uint32_t q_low;
+
+	// r < d, so that the quotient fits in 32 bits
+	asm("divl %4" : "=a"(q_low), "=d"(r) : "a"((uint32_t)n), "d"(r), "rm"(d));
+
+	if (rem)
+		*rem = r;
+
+	return ((uint64_t)q_high << 32) | q_low;
+}
+
+// (a * mul) >> shift for shift <= 32, without the 96-bit intermediate.
+static inline uint64_t
+mul64_u32_shr(uint64_t a, uint32_t mul, uint32_t shift)
+{
+	uint64_t low = ((uint64_t)(uint32_t)a * mul) >> shift;
+	uint64_t high = ((a >> 32) * mul) << (32 - shift);
+
+	return high + low;
+}
+
+/*
+ * Multiplier and shift such that (x * *mult) >> *shift is x * num / den,
+ * as precisely as a 32-bit multiplier allows. num / den must be below 2^32.
+ */
+static inline void
+mult_shift(uint32_t num, uint32_t den, uint32_t *mult, uint32_t *shift)
+{
+	for (*shift = 32; *shift > 0; (*shift)--)
+	{
+		uint64_t m = div64_u32((uint64_t)num << *shift, den, NULL);
+
+		if (m <= 0xFFFFFFFF)
+		{
+			*mult = (uint32_t)m;
+			return;
+		}
+	}
+
+	*mult = num / den;
+}
@@ -17,5 +17,6 @@
 #define KERNEL_UNRESOLVED_VIRTUAL_ADDRESS	7
 #define KERNEL_NO_SUCH_FILE_OR_FOLDER		8
 #define KERNEL_FILE_ALREADY_EXISTS		10
+#define KERNEL_TIMED_OUT			11
 #define KERNEL_NO_SUCH_DEVICE			17
 #define KERNEL_INTERNAL_FATAL_ERROR		255
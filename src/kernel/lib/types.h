@@ -14,5 +14,3 @@ typedef unsigned int		vaddr_t;	// Virtual address
 typedef int			status_t;	// Return status
 typedef uint32_t		size_t;		// Memory size of an object
 typedef int32_t			ssize_t;	// Signed size of a memory object
-
-typedef int32_t			atomic_count_t;
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/c/string.h>
+#include <lib/status.h>
+#include <arch/x86/paging.h>
+#include <memory/frame.h>
+
+#include "dma.h"
+
+void *
+dma_alloc_coherent(size_t size, dma_addr_t *dma_handle, paddr_t dma_mask,
+		size_t align, size_t boundary)
+{
+	size_t nb_pages = PAGE_ALIGN_UP(size) / PAGE_SIZE;
+	paddr_t base;
+
+	if (size == 0 || !dma_handle)
+		return NULL;
+
+	base = frame_alloc_constrained(nb_pages, dma_mask, align, boundary);
+	if (!base)
+		return NULL;
+
+	memset(PA2VA(base), 0, nb_pages * PAGE_SIZE);
+	*dma_handle = base;
+
+	return PA2VA(base);
+}
+
+void
+dma_free_coherent(void *vaddr, size_t size)
+{
+	paddr_t base = VA2PA(vaddr);
+
+	for (size_t i = 0; i < PAGE_ALIGN_UP(size) / PAGE_SIZE; i++)
+		frame_free(base + i * PAGE_SIZE);
+}
+
+static size_t
+round_up_pow2(size_t value)
+{
+	size_t pow2 = 1;
+
+	while (pow2 < value)
+		pow2 <<= 1;
+
+	return pow2;
+}
+
+status_t
+dma_pool_create(dma_pool_t *pool, const char *name, size_t block_size,
+		uint32_t nb_blocks, paddr_t dma_mask, size_t align,
+		size_t boundary)
+{
+	size_t stride;
+
+	if (block_size == 0 || nb_blocks == 0)
+		return -KERNEL_INVALID_VALUE;
+
+	// The free list is threaded through the blocks
+	if (block_size < sizeof(uint32_t))
+		block_size = sizeof(uint32_t);
+
+	if (align < sizeof(uint32_t))
+		align = sizeof(uint32_t);
+
+	stride = ALIGN_UP(block_size, align);
+
+	/*
+	 * Blocks of a power-of-two stride no larger than the boundary, laid
+	 * out from a base aligned on that stride, each fit in one boundary
+	 * window.
+	 */
+	if (boundary)
+	{
+		stride = round_up_pow2(stride);
+		if (stride > boundary)
+			return -KERNEL_INVALID_VALUE;
+
+		if (align < stride)
+			align = stride;
+	}
+
+	pool->size = stride * nb_blocks;
+	pool->vaddr = dma_alloc_coherent(pool->size, &pool->dma_base, dma_mask,
+			align, 0);
+
+	if (!pool->vaddr)
+		return -KERNEL_NO_MEMORY;
+
+	pool_init(&pool->blocks, name, pool->vaddr, stride, nb_blocks);
+
+	return KERNEL_OK;
+}
+
+void
+dma_pool_destroy(dma_pool_t *pool)
+{
+	if (!pool->vaddr)
+		return;
+
+	pool_fini(&pool->blocks);
+	dma_free_coherent(pool->vaddr, pool->size);
+	pool->vaddr = NULL;
+}
+
+void *
+dma_pool_alloc(dma_pool_t *pool, dma_addr_t *dma_handle)
+{
+	uint8_t *block = pool_allocate(&pool->blocks);
+
+	if (block && dma_handle)
+		*dma_handle = pool->dma_base + (paddr_t)(block - pool->vaddr);
+
+	return block;
+}
+
+void
+dma_pool_free(dma_pool_t *pool, void *vaddr)
+{
+	pool_deallocate(&pool->blocks, vaddr);
+}
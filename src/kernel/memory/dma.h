@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Memory that devices reach by bus mastering.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+#include <lib/status.h>
+#include <memory/pool.h>
+
+/* Highest physical address a device can generate, inclusive. */
+#define DMA_MASK_ISA	0x00FFFFFFu	/* 24-bit ISA DMA controller */
+#define DMA_MASK_32BIT	0xFFFFFFFFu	/* 32-bit PCI bus masters */
+
+typedef paddr_t dma_addr_t;
+
+/*
+ * Physically contiguous, zeroed buffer for descriptor rings and other memory
+ * shared with a device for its whole lifetime.
+ *
+ * The buffer lies below dma_mask, starts on a multiple of align and does not
+ * cross a multiple of boundary (0: no boundary). align and boundary are
+ * powers of two. x86 snoops bus master accesses, so the memory is coherent
+ * without being mapped uncached.
+ *
+ * @return the kernel address of the buffer, or NULL; *dma_handle receives
+ * the address to program into the device.
+ */
+void *dma_alloc_coherent(size_t size, dma_addr_t *dma_handle,
+		paddr_t dma_mask, size_t align, size_t boundary);
+void dma_free_coherent(void *vaddr, size_t size);
+
+/*
+ * Fixed-size buffers handed to a device one transfer at a time (packet
+ * buffers, disk sectors). All blocks come from one coherent allocation, so
+ * allocating and freeing them never touches the frame allocator.
+ */
+typedef struct dma_pool
+{
+	pool_t		blocks;
+	uint8_t		*vaddr;
+	dma_addr_t	dma_base;
+	size_t		size;
+} dma_pool_t;
+
+/*
+ * Blocks are at least block_size bytes, aligned on align and never straddle
+ * a multiple of boundary.
+ */
+status_t dma_pool_create(dma_pool_t *pool, const char *name,
+		size_t block_size, uint32_t nb_blocks, paddr_t dma_mask,
+		size_t align, size_t boundary);
+void dma_pool_destroy(dma_pool_t *pool);
+void *dma_pool_alloc(dma_pool_t *pool, dma_addr_t *dma_handle);
+void dma_pool_free(dma_pool_t *pool, void *vaddr);
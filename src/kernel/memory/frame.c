@@ -7,28 +7,46 @@
 
 #include <arch/x86-pc/bootstrap/multiboot.h>
 #include <arch/x86/paging.h>
+#include <arch/x86/irq.h>
+#include <arch/x86/smp.h>
+#include <arch/x86/spinlock.h>
+#include <arch/x86/kernel_lock.h>
+#include <process/scheduler.h>
 #include <lib/queue.h>
 #include <lib/types.h>
 #include <lib/c/string.h>
 #include <lib/c/assert.h>
+#include <lib/c/stdbool.h>
 #include "frame.h"
 
 typedef struct frame
 {
 	uint32_t address;
 	uint32_t ref_count;
-	SLIST_ENTRY(frame) next;
+	/* Reverse mapping of a private user page, 0 otherwise */
+	uint32_t owner_pd;
+	uint32_t owner_vaddr;
+	LIST_ENTRY(frame) next;
 } frame_t;
 
-SLIST_HEAD(, frame) free_frames;
-SLIST_HEAD(, frame) used_frames;
+/* Doubly linked: contiguous allocations unlink frames from the middle. */
+LIST_HEAD(, frame) free_frames;
+LIST_HEAD(, frame) used_frames;
 
 extern char __kernel_start, __kernel_end;
 
+/* Idle compaction keeps a free run of this many pages above the DMA zone. */
+#define COMPACT_IDLE_PAGES	16
+#define COMPACT_IDLE_PERIOD	100	/* idle wake-ups, about a second */
+
 static uint32_t physical_memory_start;
 static uint32_t physical_memory_end;
 static frame_t *frames_array;
 
+static struct frame_stats stats;
+
+static mcs_lock_t frame_lock = MCS_LOCK_INITIALIZER;
+
 
 status_t
 frame_setup(size_t ram_size,
@@ -42,8 +60,8 @@ frame_setup(size_t ram_size,
 
 #define FRAMES_ARRAY_ADDRSS PAGE_ALIGN_UP(initrd_end)
 
-	SLIST_INIT(&free_frames);
-	SLIST_INIT(&used_frames);
+	LIST_INIT(&free_frames);
+	LIST_INIT(&used_frames);
 
 	ram_size = PAGE_ALIGN_DOWN(ram_size);
 
@@ -51,8 +69,9 @@ frame_setup(size_t ram_size,
 	*identity_mapping_start = PAGE_ALIGN_DOWN((paddr_t)VA2PA(&__kernel_start));
 	*identity_mapping_end = FRAMES_ARRAY_ADDRSS
 		+ PAGE_ALIGN_UP((ram_size >> PAGE_SHIFT) * sizeof(frame_t));
-	/* One extra page for heap allocation-record metadata. */
-	*identity_mapping_end = PAGE_ALIGN_UP(*identity_mapping_end) + PAGE_SIZE;
+	/* Room for heap allocation-record metadata. */
+	*identity_mapping_end = PAGE_ALIGN_UP(*identity_mapping_end)
+		+ HEAP_METADATA_PAGES * PAGE_SIZE;
 
 	// Is there enough memory to fit the kernel?
 	if (*identity_mapping_end > ram_size)
@@ -83,6 +102,11 @@ frame_setup(size_t ram_size,
 		{
 			action = RESERVED;
 		}
+		else if (frame_address == AP_TRAMPOLINE_BASE)
+		{
+			// Where SmpInit() copies the AP startup code
+			action = KERNEL;
+		}
 		else if ((frame_address >= physical_memory_start)
 			&& (frame_address < vbe_mode_info->framebuffer_addr))
 		{
@@ -116,13 +140,16 @@ frame_setup(size_t ram_size,
 		{
 			case FREE:
 				frame->ref_count = 0;
-				SLIST_INSERT_HEAD(&free_frames, frame, next);
+				LIST_INSERT_HEAD(&free_frames, frame, next);
+				stats.total_frames++;
+				stats.free_frames++;
 				break;
 
 			case HARDWARE:
 			case KERNEL:
 				frame->ref_count = 1;
-				SLIST_INSERT_HEAD(&used_frames, frame, next);
+				LIST_INSERT_HEAD(&used_frames, frame, next);
+				stats.total_frames++;
 				break;
 
 			default:
@@ -147,93 +174,480 @@ frame_at_address(paddr_t frame_address)
 	return frames_array + (frame_address >> PAGE_SHIFT);
 }
 
+// Smallest order whose run of 2^order pages holds nb_pages
+static unsigned int
+frame_order(size_t nb_pages)
+{
+	unsigned int order = 0;
+
+	while (order < FRAME_STAT_ORDERS - 1 && (1u << order) < nb_pages)
+		order++;
+
+	return order;
+}
+
+static void
+frame_account_alloc(size_t nb_pages)
+{
+	stats.allocs[frame_order(nb_pages)]++;
+	stats.free_frames -= nb_pages;
+
+	if (stats.total_frames - stats.free_frames > stats.peak_used_frames)
+		stats.peak_used_frames = stats.total_frames - stats.free_frames;
+}
+
+// Drop a reference; true when the frame went back to the free list.
+static bool
+frame_put(frame_t *frame)
+{
+	frame->ref_count--;
+
+	if (frame->ref_count != 0)
+		return false;
+
+	frame->owner_pd = 0;
+	LIST_REMOVE(frame, next);
+	LIST_INSERT_HEAD(&free_frames, frame, next);
+	stats.free_frames++;
+
+	return true;
+}
+
 paddr_t
 frame_alloc(void)
 {
 	frame_t *frame;
+	struct mcs_node node;
+	uint32_t flags;
 
-	if (SLIST_EMPTY(&free_frames))
+	mcs_lock_irqsave(&frame_lock, &node, flags);
+
+	if (LIST_EMPTY(&free_frames))
+	{
+		stats.failures[0]++;
+		mcs_unlock_irqrestore(&frame_lock, &node, flags);
 		return (paddr_t)NULL;
+	}
 
-	frame = SLIST_FIRST(&free_frames);
-	SLIST_REMOVE(&free_frames, frame, frame, next);
+	frame = LIST_FIRST(&free_frames);
+	LIST_REMOVE(frame, next);
 
 	assert(frame->ref_count == 0);
 
 	frame->ref_count++;
 
-	SLIST_INSERT_HEAD(&used_frames, frame, next);
+	LIST_INSERT_HEAD(&used_frames, frame, next);
+	frame_account_alloc(1);
+
+	mcs_unlock_irqrestore(&frame_lock, &node, flags);
 
 	return frame->address;
 }
 
-paddr_t
-frame_alloc_contiguous(size_t nb_pages)
+static bool
+frame_is_movable(const frame_t *frame)
+{
+	return frame->ref_count == 1 && frame->owner_pd != 0;
+}
+
+/*
+ * Lowest run of nb_pages free frames in [low, high) whose base is a multiple
+ * of align and which does not cross a multiple of boundary (0: no limit).
+ * align and boundary are powers of two, in bytes. With movable, frames that
+ * compaction can migrate count as free.
+ */
+static paddr_t
+frame_find_run(size_t nb_pages, paddr_t low, paddr_t high,
+		size_t align, size_t boundary, bool movable)
 {
+	size_t run_size = nb_pages * PAGE_SIZE;
 	paddr_t candidate;
 	size_t i;
 
-	if (nb_pages == 0)
-		return (paddr_t)NULL;
+	if (low < physical_memory_start)
+		low = physical_memory_start;
 
-	if (nb_pages == 1)
-		return frame_alloc();
+	if (high > physical_memory_end)
+		high = physical_memory_end;
 
-	for (candidate = physical_memory_start;
-		candidate + nb_pages * PAGE_SIZE <= physical_memory_end;
-		candidate += PAGE_SIZE)
+	candidate = ALIGN_UP(low, align);
+
+	while (candidate < high && run_size <= high - candidate)
 	{
+		if (boundary && ((candidate ^ (candidate + run_size - 1))
+				 & ~(boundary - 1)))
+		{
+			candidate = ALIGN_UP((candidate | (boundary - 1)) + 1,
+					align);
+			continue;
+		}
+
 		for (i = 0; i < nb_pages; i++)
 		{
 			frame_t *frame = frame_at_address(candidate + i * PAGE_SIZE);
 
-			if (!frame || frame->ref_count != 0)
+			if (!frame || (frame->ref_count != 0
+				       && !(movable && frame_is_movable(frame))))
 				break;
 		}
 
-		if (i < nb_pages)
+		if (i == nb_pages)
+			return candidate;
+
+		// Restart past the busy frame
+		candidate = ALIGN_UP(candidate + (i + 1) * PAGE_SIZE, align);
+	}
+
+	return (paddr_t)NULL;
+}
+
+static frame_t *
+frame_alloc_outside(paddr_t base, size_t size)
+{
+	frame_t *frame;
+
+	LIST_FOREACH(frame, &free_frames, next)
+	{
+		if (frame->address < base || frame->address - base >= size)
+		{
+			LIST_REMOVE(frame, next);
+			frame->ref_count = 1;
+			LIST_INSERT_HEAD(&used_frames, frame, next);
+			stats.free_frames--;
+			return frame;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Empty [base, base + nb_pages) by moving its user pages elsewhere. Each page
+ * is copied and remapped while its process is kept off the other CPUs. The
+ * caller holds the kernel lock, so no system call holds its physical
+ * address meanwhile.
+ */
+static bool
+frame_evacuate(paddr_t base, size_t nb_pages)
+{
+	for (size_t i = 0; i < nb_pages; i++)
+	{
+		frame_t *frame = frame_at_address(base + i * PAGE_SIZE);
+		frame_t *to;
+
+		if (frame->ref_count == 0)
 			continue;
 
-		for (i = 0; i < nb_pages; i++)
+		if (!frame_is_movable(frame))
+			return false;
+
+		if (!scheduler_hold_page_directory(frame->owner_pd))
+			return false;
+
+		to = frame_alloc_outside(base, nb_pages * PAGE_SIZE);
+		if (!to)
 		{
-			frame_t *frame = frame_at_address(candidate + i * PAGE_SIZE);
+			scheduler_release_page_directory();
+			return false;
+		}
 
-			SLIST_REMOVE(&free_frames, frame, frame, next);
-			frame->ref_count = 1;
-			SLIST_INSERT_HEAD(&used_frames, frame, next);
+		if (page_migrate_user(frame->owner_pd, frame->owner_vaddr,
+				frame->address, to->address) != KERNEL_OK)
+		{
+			// Stale reverse mapping: stop considering this frame
+			frame->owner_pd = 0;
+			frame_put(to);
+			scheduler_release_page_directory();
+			return false;
 		}
 
-		return candidate;
+		scheduler_release_page_directory();
+
+		to->owner_pd = frame->owner_pd;
+		to->owner_vaddr = frame->owner_vaddr;
+		frame_put(frame);
+		stats.migrated_pages++;
 	}
 
-	return (paddr_t)NULL;
+	return true;
 }
 
-status_t
-frame_free(paddr_t frame_address)
+static paddr_t
+frame_compact(size_t nb_pages, paddr_t low, paddr_t high,
+		size_t align, size_t boundary)
 {
-	status_t status = !KERNEL_OK;
+	paddr_t base = frame_find_run(nb_pages, low, high, align, boundary, true);
+
+	if (!base || !frame_evacuate(base, nb_pages))
+		return (paddr_t)NULL;
+
+	stats.compactions++;
+
+	return base;
+}
+
+static void
+frame_claim_run(paddr_t base, size_t nb_pages)
+{
+	for (size_t i = 0; i < nb_pages; i++)
+	{
+		frame_t *frame = frame_at_address(base + i * PAGE_SIZE);
+
+		LIST_REMOVE(frame, next);
+		frame->ref_count = 1;
+		LIST_INSERT_HEAD(&used_frames, frame, next);
+	}
+
+	frame_account_alloc(nb_pages);
+}
+
+paddr_t
+frame_alloc_contiguous(size_t nb_pages)
+{
+	paddr_t base;
+	struct mcs_node node;
+	uint32_t flags;
+
+	if (nb_pages == 0)
+		return (paddr_t)NULL;
 
+	if (nb_pages == 1)
+		return frame_alloc();
+
+	mcs_lock_irqsave(&frame_lock, &node, flags);
+
+	// Keep the DMA zone for drivers as long as there is memory above it
+	base = frame_find_run(nb_pages, FRAME_DMA_ZONE_END, physical_memory_end,
+			PAGE_SIZE, 0, false);
+
+	if (!base)
+		base = frame_find_run(nb_pages, physical_memory_start,
+				physical_memory_end, PAGE_SIZE, 0, false);
+
+	// Fragmented: migrate user pages out of the way
+	if (!base)
+		base = frame_compact(nb_pages, FRAME_DMA_ZONE_END,
+				physical_memory_end, PAGE_SIZE, 0);
+
+	if (!base)
+		base = frame_compact(nb_pages, physical_memory_start,
+				physical_memory_end, PAGE_SIZE, 0);
+
+	if (base)
+		frame_claim_run(base, nb_pages);
+	else
+		stats.failures[frame_order(nb_pages)]++;
+
+	mcs_unlock_irqrestore(&frame_lock, &node, flags);
+
+	return base;
+}
+
+paddr_t
+frame_alloc_constrained(size_t nb_pages, paddr_t dma_mask,
+		size_t align, size_t boundary)
+{
+	paddr_t high;
+	paddr_t base;
+	struct mcs_node node;
+	uint32_t flags;
+
+	if (nb_pages == 0)
+		return (paddr_t)NULL;
+
+	if (align < PAGE_SIZE)
+		align = PAGE_SIZE;
+
+	if ((align & (align - 1)) || (boundary & (boundary - 1)))
+		return (paddr_t)NULL;
+
+	if (boundary && nb_pages * PAGE_SIZE > boundary)
+		return (paddr_t)NULL;
+
+	mcs_lock_irqsave(&frame_lock, &node, flags);
+
+	high = (dma_mask >= physical_memory_end - 1)
+		? physical_memory_end : dma_mask + 1;
+
+	base = frame_find_run(nb_pages, physical_memory_start, high,
+			align, boundary, false);
+
+	if (!base)
+		base = frame_compact(nb_pages, physical_memory_start, high,
+				align, boundary);
+
+	if (base)
+		frame_claim_run(base, nb_pages);
+	else
+		stats.failures[frame_order(nb_pages)]++;
+
+	mcs_unlock_irqrestore(&frame_lock, &node, flags);
+
+	return base;
+}
+
+status_t
+frame_ref(paddr_t frame_address)
+{
 	frame_t *frame = frame_at_address(frame_address);
+	status_t status = KERNEL_OK;
+	struct mcs_node node;
+	uint32_t flags;
 
 	if (!frame)
 		return -KERNEL_INVALID_VALUE;
 
-	frame->ref_count--;
+	mcs_lock_irqsave(&frame_lock, &node, flags);
 
 	if (frame->ref_count == 0)
+		status = -KERNEL_INVALID_VALUE;
+	else
+		frame->ref_count++;
+
+	mcs_unlock_irqrestore(&frame_lock, &node, flags);
+
+	return status;
+}
+
+status_t
+frame_free(paddr_t frame_address)
+{
+	frame_t *frame = frame_at_address(frame_address);
+	status_t status = !KERNEL_OK;
+	struct mcs_node node;
+	uint32_t flags;
+
+	if (!frame)
+		return -KERNEL_INVALID_VALUE;
+
+	mcs_lock_irqsave(&frame_lock, &node, flags);
+
+	if (frame_put(frame))
 	{
-		SLIST_REMOVE(&used_frames, frame, frame, next);
-		SLIST_INSERT_HEAD(&free_frames, frame, next);
+		stats.frees[0]++;
 		status = KERNEL_OK;
 	}
 
+	mcs_unlock_irqrestore(&frame_lock, &node, flags);
+
 	return status;
 }
 
 void
 frame_free_contiguous(paddr_t base, size_t nb_pages)
 {
+	bool released = false;
+	struct mcs_node node;
+	uint32_t flags;
+
+	mcs_lock_irqsave(&frame_lock, &node, flags);
+
 	for (size_t i = 0; i < nb_pages; i++)
-		frame_free(base + i * PAGE_SIZE);
+	{
+		frame_t *frame = frame_at_address(base + i * PAGE_SIZE);
+
+		if (frame && frame_put(frame))
+			released = true;
+	}
+
+	if (released)
+		stats.frees[frame_order(nb_pages)]++;
+
+	mcs_unlock_irqrestore(&frame_lock, &node, flags);
+}
+
+void
+frame_set_owner(paddr_t frame_address, uint32_t pd, uint32_t vaddr)
+{
+	frame_t *frame = frame_at_address(frame_address);
+	struct mcs_node node;
+	uint32_t flags;
+
+	if (!frame)
+		return;
+
+	mcs_lock_irqsave(&frame_lock, &node, flags);
+	frame->owner_pd = pd;
+	frame->owner_vaddr = vaddr;
+	mcs_unlock_irqrestore(&frame_lock, &node, flags);
+}
+
+void
+frame_compact_idle(void)
+{
+	static uint32_t wakeups;
+	struct mcs_node node;
+	uint32_t flags;
+
+	if (++wakeups < COMPACT_IDLE_PERIOD)
+		return;
+
+	wakeups = 0;
+
+	// Idle threads run outside the kernel lock; see frame_evacuate()
+	X86_IRQs_DISABLE(flags);
+	kernel_lock();
+	mcs_lock(&frame_lock, &node);
+
+	if (!frame_find_run(COMPACT_IDLE_PAGES, FRAME_DMA_ZONE_END,
+			physical_memory_end, PAGE_SIZE, 0, false))
+		frame_compact(COMPACT_IDLE_PAGES, FRAME_DMA_ZONE_END,
+				physical_memory_end, PAGE_SIZE, 0);
+
+	mcs_unlock(&frame_lock, &node);
+	kernel_unlock();
+	X86_IRQs_ENABLE(flags);
+}
+
+void
+frame_get_stats(struct frame_stats *out)
+{
+	uint32_t usable[FRAME_STAT_ORDERS] = { 0 };
+	uint32_t run = 0;
+	unsigned int order;
+	struct mcs_node node;
+	uint32_t flags;
+
+	mcs_lock_irqsave(&frame_lock, &node, flags);
+
+	memcpy(out, &stats, sizeof(*out));
+	memset(out->free_runs, 0, sizeof(out->free_runs));
+
+	// Walk maximal free runs; one past the end closes the last one
+	for (paddr_t address = physical_memory_start;
+	     address <= physical_memory_end; address += PAGE_SIZE)
+	{
+		frame_t *frame = address < physical_memory_end
+			? frame_at_address(address) : NULL;
+
+		if (frame && frame->ref_count == 0)
+		{
+			run++;
+			continue;
+		}
+
+		if (run == 0)
+			continue;
+
+		for (order = 0; order < FRAME_STAT_ORDERS - 1
+		     && (2u << order) <= run; order++)
+			;
+
+		out->free_runs[order]++;
+
+		for (order = 0; order < FRAME_STAT_ORDERS; order++)
+			usable[order] += (run >> order) << order;
+
+		run = 0;
+	}
+
+	mcs_unlock_irqrestore(&frame_lock, &node, flags);
+
+	for (order = 0; order < FRAME_STAT_ORDERS; order++)
+	{
+		out->fragmentation[order] = out->free_frames
+			? (out->free_frames - usable[order]) * 1000
+				/ out->free_frames
+			: 0;
+	}
 }
@@ -24,9 +24,40 @@
 	({ unsigned int __boundary = (PAGE_SIZE); \
 	(((((unsigned)(value))-1) & (~(__boundary - 1))) + __boundary); })
 
+/* Power-of-two alignment */
+#define ALIGN_UP(value, align) \
+	(((unsigned)(value) + ((unsigned)(align) - 1)) & ~((unsigned)(align) - 1))
+
+/* Reserved after the frame array for heap allocation records */
+#define HEAP_METADATA_PAGES 4
+
+/* Legacy ISA DMA reaches the first 16 MiB only */
+#define FRAME_DMA_ZONE_END 0x01000000u
+
 #define IS_PAGE_ALIGNED(value) \
 	(0 == (((unsigned)(value)) & ((PAGE_SIZE)-1)))
 
+/* Runs of 1 page (order 0) up to 4 MiB (order 10) */
+#define FRAME_STAT_ORDERS 11
+
+struct frame_stats
+{
+	uint32_t total_frames;
+	uint32_t free_frames;
+	uint32_t peak_used_frames;
+	uint32_t allocs[FRAME_STAT_ORDERS];	/* by order of the request */
+	uint32_t frees[FRAME_STAT_ORDERS];
+	uint32_t failures[FRAME_STAT_ORDERS];
+	uint32_t free_runs[FRAME_STAT_ORDERS];	/* maximal free runs by order */
+	/*
+	 * Share of free memory, per mille, lying in runs too short to serve
+	 * a request of that order: 0 means unfragmented.
+	 */
+	uint32_t fragmentation[FRAME_STAT_ORDERS];
+	uint32_t compactions;
+	uint32_t migrated_pages;
+};
+
 status_t frame_setup(size_t ram_size,
 		struct vbe_mode_info *vbe_mode_info,
 		paddr_t *identity_mapping_start,
@@ -35,5 +66,19 @@ status_t frame_setup(size_t ram_size,
 
 paddr_t frame_alloc(void);
 paddr_t frame_alloc_contiguous(size_t nb_pages);
+paddr_t frame_alloc_constrained(size_t nb_pages, paddr_t dma_mask,
+		size_t align, size_t boundary);
+status_t frame_ref(paddr_t frame_address);
 status_t frame_free(paddr_t frame_address);
 void frame_free_contiguous(paddr_t base, size_t nb_pages);
+
+/*
+ * Record the single user mapping of a private page (pd 0: none). Only such
+ * pages are migrated by compaction.
+ */
+void frame_set_owner(paddr_t frame_address, uint32_t pd, uint32_t vaddr);
+
+// Background compaction, called from the idle thread.
+void frame_compact_idle(void);
+
+void frame_get_stats(struct frame_stats *stats);
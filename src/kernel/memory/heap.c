@@ -11,7 +11,9 @@
 #include <lib/c/stdio.h>
 #include <memory/frame.h>
 #include <arch/x86/paging.h>
+#include <arch/x86/spinlock.h>
 #include "heap.h"
+#include "heap_profile.h"
 
 static uint32_t metadata_heap;
 static vaddr_t metadata_end;
@@ -23,9 +25,29 @@ struct memory_range
 {
 	uint32_t base_address;
 	uint32_t nb_pages;
+	uint32_t size;		/* as requested */
+#ifdef CONFIG_HEAP_PROFILE
+	void *caller;
+#endif
 	SLIST_ENTRY(memory_range) next;
 };
 
+static struct heap_stats stats;
+
+static ticket_lock_t heap_lock = TICKET_LOCK_INITIALIZER;
+
+// Size class i holds requests of up to 16 << i bytes; the last one the rest
+static unsigned int
+size_class(size_t size)
+{
+	unsigned int i = 0;
+
+	while (i < HEAP_STAT_CLASSES - 1 && ((size_t)16 << i) < size)
+		i++;
+
+	return i;
+}
+
 static struct memory_range *
 range_metadata_alloc(void)
 {
@@ -71,18 +93,30 @@ heap_setup(size_t ram_size,
 	 * Use the higher-half mapping so malloc works under a process CR3.
 	 */
 	metadata_end = (vaddr_t)PA2VA(PAGE_ALIGN_UP(identity_mapping_end));
-	metadata_heap = metadata_end - PAGE_SIZE;
+	metadata_heap = metadata_end - HEAP_METADATA_PAGES * PAGE_SIZE;
 }
 
 void *
 heap_alloc(size_t size)
+{
+	return heap_alloc_from(size, __builtin_return_address(0));
+}
+
+void *
+heap_alloc_from(size_t size, void *caller)
 {
 	size_t nb_pages = size == 0 ? 1 : (size + PAGE_SIZE - 1) / PAGE_SIZE;
-	paddr_t base = frame_alloc_contiguous(nb_pages);
 	struct memory_range *range;
+	uint32_t flags;
+	paddr_t base;
 
+	ticket_lock_irqsave(&heap_lock, flags);
+
+	base = frame_alloc_contiguous(nb_pages);
 	if (!base)
 	{
+		stats.failures++;
+		ticket_unlock_irqrestore(&heap_lock, flags);
 		kprintf("alloc failed!\n");
 		return NULL;
 	}
@@ -90,8 +124,29 @@ heap_alloc(size_t size)
 	range = range_metadata_alloc();
 	range->base_address = base;
 	range->nb_pages = nb_pages;
+	range->size = size;
 	SLIST_INSERT_HEAD(&used_ranges, range, next);
 
+#ifdef CONFIG_HEAP_PROFILE
+	range->caller = caller;
+	heap_profile_alloc(caller, size);
+#else
+	(void)caller;
+#endif
+
+	stats.allocs[size_class(size)]++;
+	stats.live_allocations++;
+	stats.live_bytes += size;
+	stats.live_pages += nb_pages;
+
+	if (stats.live_bytes > stats.peak_bytes)
+		stats.peak_bytes = stats.live_bytes;
+
+	if (stats.live_pages > stats.peak_pages)
+		stats.peak_pages = stats.live_pages;
+
+	ticket_unlock_irqrestore(&heap_lock, flags);
+
 	return PA2VA(base);
 }
 
@@ -99,23 +154,49 @@ void
 heap_free(void *address)
 {
 	struct memory_range *range;
+	uint32_t flags;
 
 	if (!address)
 		return;
 
 	uint32_t physical_address = VA2PA(address);
 
+	ticket_lock_irqsave(&heap_lock, flags);
+
 	SLIST_FOREACH(range, &used_ranges, next)
 	{
 		if (range->base_address == physical_address)
 		{
 			frame_free_contiguous(range->base_address, range->nb_pages);
 			SLIST_REMOVE(&used_ranges, range, memory_range, next);
+
+			stats.frees[size_class(range->size)]++;
+			stats.live_allocations--;
+			stats.live_bytes -= range->size;
+			stats.live_pages -= range->nb_pages;
+
+#ifdef CONFIG_HEAP_PROFILE
+			heap_profile_free(range->caller, range->size);
+#endif
+
 			range_metadata_free(range);
+			ticket_unlock_irqrestore(&heap_lock, flags);
 			return;
 		}
 	}
 
+	ticket_unlock_irqrestore(&heap_lock, flags);
+
 	kprintf("heap_free: invalid pointer %p\n", address);
 	assert(0);
 }
+
+void
+heap_get_stats(struct heap_stats *out)
+{
+	uint32_t flags;
+
+	ticket_lock_irqsave(&heap_lock, flags);
+	memcpy(out, &stats, sizeof(*out));
+	ticket_unlock_irqrestore(&heap_lock, flags);
+}
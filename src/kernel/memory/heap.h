@@ -10,6 +10,21 @@
 #include <lib/types.h>
 #include <drivers/vbe.h>
 
+/* Request sizes up to 16 bytes, 32 bytes, ... 256 KiB, then larger */
+#define HEAP_STAT_CLASSES 16
+
+struct heap_stats
+{
+	uint32_t allocs[HEAP_STAT_CLASSES];
+	uint32_t frees[HEAP_STAT_CLASSES];
+	uint32_t failures;
+	uint32_t live_allocations;
+	uint32_t live_bytes;		/* requested */
+	uint32_t peak_bytes;
+	uint32_t live_pages;		/* backing them */
+	uint32_t peak_pages;
+};
+
 void heap_setup(size_t ram_size,
 		vaddr_t identity_mapping_start,
 		vaddr_t identity_mapping_end,
@@ -17,4 +32,7 @@ void heap_setup(size_t ram_size,
 		uint32_t framebuffer_end);
 
 void *heap_alloc(size_t size);
+// caller is the allocation site reported by the heap profiler
+void *heap_alloc_from(size_t size, void *caller);
 void heap_free(void *ptr);
+void heap_get_stats(struct heap_stats *stats);
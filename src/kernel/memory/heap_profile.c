@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/c/stdio.h>
+#include <lib/c/string.h>
+#include <arch/x86/irq.h>
+#include <arch/x86-pc/ksyms.h>
+#include "heap_profile.h"
+
+#ifdef CONFIG_HEAP_PROFILE
+
+#define PROFILE_SITES_SHIFT	9
+#define PROFILE_SITES		(1u << PROFILE_SITES_SHIFT)
+#define PROFILE_REPORT_TOP	20
+
+struct alloc_site
+{
+	void		*caller;	/* NULL: free slot */
+	uint32_t	live_bytes;
+	uint32_t	live_allocs;
+	uint32_t	total_allocs;
+};
+
+/* Open addressing with linear probing; sites are never removed. */
+static struct alloc_site sites[PROFILE_SITES];
+static struct alloc_site overflow;	/* everything past a full table */
+
+static struct alloc_site *
+site_lookup(void *caller)
+{
+	// Fibonacci hashing of the return address
+	uint32_t i = ((uint32_t)caller * 2654435761u) >> (32 - PROFILE_SITES_SHIFT);
+
+	for (uint32_t probe = 0; probe < PROFILE_SITES; probe++)
+	{
+		struct alloc_site *site = &sites[(i + probe) & (PROFILE_SITES - 1)];
+
+		if (site->caller == caller)
+			return site;
+
+		if (!site->caller)
+		{
+			site->caller = caller;
+			return site;
+		}
+	}
+
+	return &overflow;
+}
+
+void
+heap_profile_alloc(void *caller, size_t size)
+{
+	uint32_t flags;
+	struct alloc_site *site;
+
+	X86_IRQs_DISABLE(flags);
+
+	site = site_lookup(caller);
+	site->live_bytes += size;
+	site->live_allocs++;
+	site->total_allocs++;
+
+	X86_IRQs_ENABLE(flags);
+}
+
+void
+heap_profile_free(void *caller, size_t size)
+{
+	uint32_t flags;
+	struct alloc_site *site;
+
+	X86_IRQs_DISABLE(flags);
+
+	site = site_lookup(caller);
+	site->live_bytes -= size;
+	site->live_allocs--;
+
+	X86_IRQs_ENABLE(flags);
+}
+
+static void
+site_print(const struct alloc_site *site)
+{
+	uint32_t offset = 0;
+	const char *name = site->caller
+		? ksyms_lookup((uint32_t)site->caller, &offset) : "(other)";
+
+	if (name)
+		kprintf("%u %u %u %s+0x%x\n", (unsigned int)site->live_bytes,
+			(unsigned int)site->live_allocs,
+			(unsigned int)site->total_allocs, name,
+			(unsigned int)offset);
+	else
+		kprintf("%u %u %u %p\n", (unsigned int)site->live_bytes,
+			(unsigned int)site->live_allocs,
+			(unsigned int)site->total_allocs, site->caller);
+}
+
+status_t
+heap_profile_report(void)
+{
+	const struct alloc_site *previous = NULL;
+	uint32_t total = overflow.live_bytes;
+	uint32_t nb_sites = 0;
+
+	for (uint32_t i = 0; i < PROFILE_SITES; i++)
+	{
+		if (sites[i].caller)
+		{
+			total += sites[i].live_bytes;
+			nb_sites++;
+		}
+	}
+
+	kprintf("Heap profile: %u bytes live from %u call sites\n",
+		(unsigned int)total, (unsigned int)nb_sites);
+	kprintf("live-bytes live-allocs total-allocs site\n");
+
+	// Largest first, by repeated selection: the table stays hashed
+	for (uint32_t n = 0; n < PROFILE_REPORT_TOP; n++)
+	{
+		const struct alloc_site *best = NULL;
+
+		for (uint32_t i = 0; i < PROFILE_SITES; i++)
+		{
+			const struct alloc_site *site = &sites[i];
+
+			if (!site->caller || site->live_bytes == 0)
+				continue;
+
+			// Strictly after previous in (live_bytes desc, slot asc)
+			if (previous && (site->live_bytes > previous->live_bytes
+			    || (site->live_bytes == previous->live_bytes
+				&& site <= previous)))
+				continue;
+
+			if (!best || site->live_bytes > best->live_bytes)
+				best = site;
+		}
+
+		if (!best)
+			break;
+
+		site_print(best);
+		previous = best;
+	}
+
+	if (overflow.live_allocs)
+		site_print(&overflow);
+
+	return KERNEL_OK;
+}
+
+#else
+
+status_t
+heap_profile_report(void)
+{
+	return -KERNEL_OPERATION_NOT_SUPPORTED;
+}
+
+#endif
@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Allocation-site heap profiler, built with `make PROFILE=on`.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+#include <lib/status.h>
+
+// Account size bytes allocated (or freed) on behalf of the code at caller.
+void heap_profile_alloc(void *caller, size_t size);
+void heap_profile_free(void *caller, size_t size);
+
+/*
+ * Print the call sites holding the most live heap memory to the console.
+ * Returns -KERNEL_OPERATION_NOT_SUPPORTED when the profiler is not built in.
+ */
+status_t heap_profile_report(void);
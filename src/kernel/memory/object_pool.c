@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/c/assert.h>
+#include <lib/c/stdlib.h>
+#include <lib/c/string.h>
+#include <arch/x86/irq.h>
+#include "object_pool.h"
+
+/*
+ * Magazine-style caching (see Bonwick & Adams, "Magazines and Vmem"): each
+ * CPU allocates from and frees to its own cache, and only goes to the
+ * shared depot a batch at a time. Objects never return to their chunk, so
+ * constructed state survives until the pool is destroyed. A cache is only
+ * touched by its CPU, with interrupts off; the depot and chunks take the
+ * pool lock.
+ */
+
+#define OBJECT_ALIGN 8
+
+status_t
+object_pool_init(object_pool_t *pool, const char *name, size_t object_size,
+		object_ctor_t ctor, object_dtor_t dtor)
+{
+	size_t header = ALIGN_UP(sizeof(struct object_chunk), OBJECT_ALIGN);
+	size_t chunk_size;
+
+	if (object_size == 0)
+		return -KERNEL_INVALID_VALUE;
+
+	memset(pool, 0, sizeof(*pool));
+
+	// The chunk's pool_t threads its free list through the blocks
+	pool->object_size = ALIGN_UP(object_size, OBJECT_ALIGN);
+
+	chunk_size = header + pool->object_size;
+	chunk_size = chunk_size < OBJECT_CHUNK_SIZE
+		? OBJECT_CHUNK_SIZE : PAGE_ALIGN_UP(chunk_size);
+
+	pool->name = name;
+	pool->objects_per_chunk = (chunk_size - header) / pool->object_size;
+	pool->ctor = ctor;
+	pool->dtor = dtor;
+	spinlock_init(&pool->lock);
+	LIST_INIT(&pool->chunks);
+
+	return KERNEL_OK;
+}
+
+static status_t
+chunk_grow(object_pool_t *pool)
+{
+	size_t header = ALIGN_UP(sizeof(struct object_chunk), OBJECT_ALIGN);
+	uint32_t capacity = pool->depot_capacity + pool->objects_per_chunk;
+	struct object_chunk *chunk;
+	void **depot;
+
+	// The depot can hold every object, so a flush never overflows it
+	depot = malloc(capacity * sizeof(void *));
+	if (!depot)
+		return -KERNEL_NO_MEMORY;
+
+	chunk = malloc(header + pool->objects_per_chunk * pool->object_size);
+	if (!chunk)
+	{
+		free(depot);
+		return -KERNEL_NO_MEMORY;
+	}
+
+	if (pool->depot)
+	{
+		memcpy(depot, pool->depot, pool->depot_count * sizeof(void *));
+		free(pool->depot);
+	}
+
+	pool->depot = depot;
+	pool->depot_capacity = capacity;
+
+	pool_init(&chunk->blocks, pool->name, (uint8_t *)chunk + header,
+			pool->object_size, pool->objects_per_chunk);
+	LIST_INSERT_HEAD(&pool->chunks, chunk, next);
+
+	return KERNEL_OK;
+}
+
+// Construct new objects straight into the cache.
+static void
+cache_carve(object_pool_t *pool, struct object_cache *cache)
+{
+	while (cache->nb_objects < OBJECT_CACHE_BATCH)
+	{
+		struct object_chunk *chunk = LIST_FIRST(&pool->chunks);
+		void *object;
+
+		if (!chunk || chunk->blocks.nb_free_blocks == 0)
+		{
+			if (chunk_grow(pool) != KERNEL_OK)
+				return;
+
+			continue;
+		}
+
+		object = pool_allocate(&chunk->blocks);
+
+		if (pool->ctor && pool->ctor(object) != KERNEL_OK)
+		{
+			pool_deallocate(&chunk->blocks, object);
+			return;
+		}
+
+		pool->nb_objects++;
+		cache->objects[cache->nb_objects++] = object;
+	}
+}
+
+static void
+cache_refill(object_pool_t *pool, struct object_cache *cache)
+{
+	while (cache->nb_objects < OBJECT_CACHE_BATCH && pool->depot_count > 0)
+		cache->objects[cache->nb_objects++] = pool->depot[--pool->depot_count];
+
+	if (cache->nb_objects == 0)
+		cache_carve(pool, cache);
+}
+
+static void
+cache_flush(object_pool_t *pool, struct object_cache *cache, uint32_t count)
+{
+	while (count-- > 0 && cache->nb_objects > 0)
+		pool->depot[pool->depot_count++] = cache->objects[--cache->nb_objects];
+}
+
+void *
+object_pool_alloc(object_pool_t *pool)
+{
+	struct object_cache *cache;
+	void *object = NULL;
+	uint32_t flags;
+
+	X86_IRQs_DISABLE(flags);
+
+	cache = &pool->caches[cpu_current_index()];
+
+	if (cache->nb_objects == 0)
+	{
+		spin_lock(&pool->lock);
+		cache_refill(pool, cache);
+		spin_unlock(&pool->lock);
+	}
+
+	if (cache->nb_objects > 0)
+		object = cache->objects[--cache->nb_objects];
+
+	X86_IRQs_ENABLE(flags);
+
+	return object;
+}
+
+void
+object_pool_free(object_pool_t *pool, void *object)
+{
+	struct object_cache *cache;
+	uint32_t flags;
+
+	if (!object)
+		return;
+
+	X86_IRQs_DISABLE(flags);
+
+	cache = &pool->caches[cpu_current_index()];
+
+	if (cache->nb_objects == OBJECT_CACHE_SIZE)
+	{
+		spin_lock(&pool->lock);
+		cache_flush(pool, cache, OBJECT_CACHE_BATCH);
+		spin_unlock(&pool->lock);
+	}
+
+	cache->objects[cache->nb_objects++] = object;
+
+	X86_IRQs_ENABLE(flags);
+}
+
+void
+object_pool_destroy(object_pool_t *pool)
+{
+	struct object_chunk *chunk;
+
+	for (uint32_t cpu = 0; cpu < NB_CPUS; cpu++)
+		cache_flush(pool, &pool->caches[cpu], OBJECT_CACHE_SIZE);
+
+	assert(pool->depot_count == pool->nb_objects);
+
+	if (pool->dtor)
+	{
+		for (uint32_t i = 0; i < pool->depot_count; i++)
+			pool->dtor(pool->depot[i]);
+	}
+
+	while ((chunk = LIST_FIRST(&pool->chunks)) != NULL)
+	{
+		LIST_REMOVE(chunk, next);
+		pool_fini(&chunk->blocks);
+		free(chunk);
+	}
+
+	free(pool->depot);
+	memset(pool, 0, sizeof(*pool));
+}
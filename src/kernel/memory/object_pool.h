@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Growable pools of same-sized kernel objects.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+#include <lib/queue.h>
+#include <lib/status.h>
+#include <arch/x86/percpu.h>
+#include <arch/x86/spinlock.h>
+#include <memory/frame.h>
+#include <memory/pool.h>
+
+/* Objects a CPU keeps for itself, and how many move to/from the depot. */
+#define OBJECT_CACHE_SIZE	16
+#define OBJECT_CACHE_BATCH	8
+
+/* Objects are carved out of chunks of at least this size. */
+#define OBJECT_CHUNK_SIZE	(4 * PAGE_SIZE)
+
+/*
+ * The constructor runs once, when an object is carved out of a chunk; the
+ * object keeps its constructed state while it sits in the pool, and the
+ * destructor runs when the pool is destroyed. Either may be NULL.
+ */
+typedef status_t (*object_ctor_t)(void *object);
+typedef void (*object_dtor_t)(void *object);
+
+struct object_chunk
+{
+	pool_t blocks;
+	LIST_ENTRY(object_chunk) next;
+};
+
+struct object_cache
+{
+	uint32_t nb_objects;
+	void *objects[OBJECT_CACHE_SIZE];
+};
+
+typedef struct object_pool
+{
+	const char	*name;
+	uint32_t	object_size;
+	uint32_t	objects_per_chunk;
+	object_ctor_t	ctor;
+	object_dtor_t	dtor;
+
+	spinlock_t	lock;			/* chunks and depot */
+	LIST_HEAD(, object_chunk) chunks;	/* head: the one being carved */
+	uint32_t	nb_objects;		/* carved so far */
+
+	/* Shared depot of free objects, sized for every carved object */
+	void		**depot;
+	uint32_t	depot_count;
+	uint32_t	depot_capacity;
+
+	struct object_cache caches[NB_CPUS];
+} object_pool_t;
+
+status_t object_pool_init(object_pool_t *pool, const char *name,
+		size_t object_size, object_ctor_t ctor, object_dtor_t dtor);
+// Every object must have been freed.
+void object_pool_destroy(object_pool_t *pool);
+
+void *object_pool_alloc(object_pool_t *pool);
+void object_pool_free(object_pool_t *pool, void *object);
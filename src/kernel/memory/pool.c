@@ -7,26 +7,64 @@
 
 #include <lib/c/string.h>
 #include <lib/c/stdlib.h>
+#include <arch/x86/spinlock.h>
 #include "pool.h"
 
 
 // See a paper called: Fast Efficient Fixed-Size Memory Pool
 
+static LIST_HEAD(, pool) pools = LIST_HEAD_INITIALIZER(pools);
+static spinlock_t pools_lock = SPINLOCK_INITIALIZER;
+
+void
+pool_init(pool_t *pool, const char *name, void *memory, uint32_t block_size,
+		uint32_t nb_blocks)
+{
+	uint32_t flags;
+
+	pool->nb_blocks			= nb_blocks;
+	pool->block_size		= block_size;
+	pool->mem_pool_start		= memory;
+	pool->nb_free_blocks 		= memory ? nb_blocks : 0;
+	pool->nb_initialized_blocks	= memory ? 0 : nb_blocks;
+	pool->next_mem_pool 		= pool->mem_pool_start;
+
+	pool->name		= name;
+	pool->nb_allocs		= 0;
+	pool->nb_frees		= 0;
+	pool->nb_failures	= 0;
+	pool->peak_used		= 0;
+
+	spin_lock_irqsave(&pools_lock, flags);
+	LIST_INSERT_HEAD(&pools, pool, next);
+	spin_unlock_irqrestore(&pools_lock, flags);
+}
+
 void
-pool_create(pool_t *pool, uint32_t block_size, uint32_t nb_blocks)
+pool_fini(pool_t *pool)
 {
-	pool->nb_blocks		= nb_blocks;
-	pool->block_size	= block_size;
-	pool->mem_pool_start	= malloc(nb_blocks * block_size);
-	pool->nb_free_blocks 	= nb_blocks;
-	pool->next_mem_pool 	= pool->mem_pool_start;
+	uint32_t flags;
+
+	spin_lock_irqsave(&pools_lock, flags);
+	LIST_REMOVE(pool, next);
+	spin_unlock_irqrestore(&pools_lock, flags);
+
+	pool->mem_pool_start = NULL;
+}
+
+void
+pool_create(pool_t *pool, const char *name, uint32_t block_size,
+		uint32_t nb_blocks)
+{
+	pool_init(pool, name, malloc(nb_blocks * block_size), block_size,
+			nb_blocks);
 }
 
 void
 pool_destroy(pool_t *pool)
 {
 	free(pool->mem_pool_start);
-	pool->mem_pool_start = NULL;
+	pool_fini(pool);
 }
 
 static unsigned char *
@@ -62,6 +100,15 @@ pool_allocate(pool_t *pool)
 			pool->next_mem_pool = address_from_index(pool, *((uint32_t *)pool->next_mem_pool));
 		else
 			pool->next_mem_pool = NULL;
+
+		pool->nb_allocs++;
+
+		if (pool->nb_blocks - pool->nb_free_blocks > pool->peak_used)
+			pool->peak_used = pool->nb_blocks - pool->nb_free_blocks;
+	}
+	else
+	{
+		pool->nb_failures++;
 	}
 
 	return ret;
@@ -82,4 +129,38 @@ pool_deallocate(pool_t *pool, void *ptr)
 	}
 
 	++pool->nb_free_blocks;
+	pool->nb_frees++;
+}
+
+status_t
+pool_get_stats(uint32_t index, struct pool_stats *stats)
+{
+	pool_t *pool;
+	uint32_t flags;
+
+	spin_lock_irqsave(&pools_lock, flags);
+
+	LIST_FOREACH(pool, &pools, next)
+	{
+		if (index-- != 0)
+			continue;
+
+		memset(stats, 0, sizeof(*stats));
+		strzcpy(stats->name, pool->name ? pool->name : "?",
+				sizeof(stats->name));
+		stats->block_size	= pool->block_size;
+		stats->nb_blocks	= pool->nb_blocks;
+		stats->used		= pool->nb_blocks - pool->nb_free_blocks;
+		stats->peak_used	= pool->peak_used;
+		stats->allocs		= pool->nb_allocs;
+		stats->frees		= pool->nb_frees;
+		stats->failures		= pool->nb_failures;
+
+		spin_unlock_irqrestore(&pools_lock, flags);
+		return KERNEL_OK;
+	}
+
+	spin_unlock_irqrestore(&pools_lock, flags);
+
+	return -KERNEL_INVALID_VALUE;
 }
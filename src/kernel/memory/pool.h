@@ -8,8 +8,12 @@
 #pragma once
 
 #include <lib/types.h>
+#include <lib/queue.h>
+#include <lib/status.h>
 
-typedef struct
+#define POOL_NAME_LENGTH 16
+
+typedef struct pool
 {
 	uint32_t 	nb_blocks;
 	uint32_t 	block_size;
@@ -17,10 +21,38 @@ typedef struct
 	uint32_t 	nb_initialized_blocks;
 	unsigned char 	*mem_pool_start;
 	unsigned char 	*next_mem_pool;
+
+	/* Statistics */
+	const char	*name;
+	uint32_t	nb_allocs;
+	uint32_t	nb_frees;
+	uint32_t	nb_failures;
+	uint32_t	peak_used;
+	LIST_ENTRY(pool) next;	/* all live pools */
 } pool_t;
 
+struct pool_stats
+{
+	char		name[POOL_NAME_LENGTH];
+	uint32_t	block_size;
+	uint32_t	nb_blocks;
+	uint32_t	used;
+	uint32_t	peak_used;
+	uint32_t	allocs;
+	uint32_t	frees;
+	uint32_t	failures;
+};
 
-void pool_create(pool_t *pool, uint32_t block_size, uint32_t nb_blocks);
+// Carve blocks out of caller-provided memory (nb_blocks * block_size bytes)
+void pool_init(pool_t *pool, const char *name, void *memory,
+		uint32_t block_size, uint32_t nb_blocks);
+// Forget a pool set up by pool_init; its memory belongs to the caller.
+void pool_fini(pool_t *pool);
+void pool_create(pool_t *pool, const char *name, uint32_t block_size,
+		uint32_t nb_blocks);
 void pool_destroy(pool_t *pool);
 void *pool_allocate(pool_t *pool);
 void pool_deallocate(pool_t *pool, void *ptr);
+
+// Statistics of the index-th live pool
+status_t pool_get_stats(uint32_t index, struct pool_stats *stats);
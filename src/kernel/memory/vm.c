@@ -0,0 +1,502 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/c/stdlib.h>
+#include <lib/c/string.h>
+#include <lib/c/stdio.h>
+#include <lib/c/assert.h>
+#include <arch/x86/isr.h>
+#include <arch/x86/paging.h>
+#include <arch/x86/kernel_lock.h>
+#include <memory/frame.h>
+#include <memory/object_pool.h>
+#include <process/process.h>
+#include <process/thread.h>
+
+#include "vm.h"
+
+#define PF_PROTECTION	0x1	/* Fault on a present page */
+#define PF_WRITE	0x2
+#define PF_USER		0x4
+
+static object_pool_t region_pool;
+
+static struct vm_region *
+region_find(process_t *p, uint32_t addr)
+{
+	struct vm_region *r;
+
+	TAILQ_FOREACH(r, &p->regions, next)
+	{
+		if (addr < r->start)
+			break;
+
+		if (addr < r->end)
+			return r;
+	}
+
+	return NULL;
+}
+
+static void
+region_insert(process_t *p, struct vm_region *region)
+{
+	struct vm_region *r;
+
+	TAILQ_FOREACH(r, &p->regions, next)
+	{
+		if (r->start > region->start)
+		{
+			TAILQ_INSERT_BEFORE(r, region, next);
+			return;
+		}
+	}
+
+	TAILQ_INSERT_TAIL(&p->regions, region, next);
+}
+
+/* Cut r at address at; returns the new region holding [at, end). */
+static struct vm_region *
+region_split(process_t *p, struct vm_region *r, uint32_t at)
+{
+	struct vm_region *tail = object_pool_alloc(&region_pool);
+
+	if (!tail)
+		return NULL;
+
+	memcpy(tail, r, sizeof(*tail));
+	tail->start = at;
+
+	if (tail->file)
+		tail->file_base = r->file_base + (at - r->start);
+
+	r->end = at;
+	TAILQ_INSERT_AFTER(&p->regions, r, tail, next);
+
+	return tail;
+}
+
+static bool
+range_is_free(process_t *p, uint32_t start, uint32_t size)
+{
+	struct vm_region *r;
+
+	TAILQ_FOREACH(r, &p->regions, next)
+	{
+		if (r->start < start + size && start < r->end)
+			return false;
+	}
+
+	return true;
+}
+
+// First fit in the mmap window, trying the caller's hint first.
+static uint32_t
+range_find(process_t *p, uint32_t hint, uint32_t size)
+{
+	struct vm_region *r;
+	uint32_t candidate = VM_MMAP_BASE;
+
+	if (hint && IS_PAGE_ALIGNED(hint) && hint >= VM_MMAP_BASE
+	    && hint < VM_MMAP_END && size <= VM_MMAP_END - hint
+	    && range_is_free(p, hint, size))
+	{
+		return hint;
+	}
+
+	TAILQ_FOREACH(r, &p->regions, next)
+	{
+		if (r->start >= candidate + size)
+			break;
+
+		if (r->end > candidate)
+			candidate = r->end;
+	}
+
+	if (size > VM_MMAP_END - candidate)
+		return 0;
+
+	return candidate;
+}
+
+static uint32_t
+prot_to_page_flags(uint32_t prot)
+{
+	if (!(prot & (PROT_READ | PROT_WRITE)))
+		return 0;	/* PROT_NONE: supervisor-only page */
+
+	return PAGE_USER | ((prot & PROT_WRITE) ? PAGE_RW : 0);
+}
+
+static void
+region_unmap_pages(process_t *p, struct vm_region *r)
+{
+	for (uint32_t va = r->start; va < r->end; va += PAGE_SIZE)
+	{
+		paddr_t frame = page_unmap_user(p->page_directory, va);
+
+		if (frame)
+			frame_free(frame);
+	}
+}
+
+// Back a page of r with a frame, unless it already is.
+static status_t
+region_map_page(process_t *p, struct vm_region *r, uint32_t page)
+{
+	paddr_t frame;
+	uint32_t flags;
+
+	if (page_lookup(p->page_directory, page))
+		return KERNEL_OK;
+
+	flags = prot_to_page_flags(r->prot);
+
+	if (r->file)
+	{
+		frame = r->file_base + (page - r->start);
+		frame_ref(frame);
+		flags |= PAGE_SHARED;
+	}
+	else
+	{
+		frame = frame_alloc();
+		if (!frame)
+			return -KERNEL_NO_MEMORY;
+
+		memset(PA2VA(frame), 0, PAGE_SIZE);
+
+		if (r->flags & MAP_SHARED)
+			flags |= PAGE_SHARED;
+	}
+
+	if (page_map_user(p->page_directory, page, frame, flags) != KERNEL_OK)
+	{
+		frame_free(frame);
+		return -KERNEL_NO_MEMORY;
+	}
+
+	// Shared pages are mapped even PROT_NONE, but out of user reach
+	if (!(flags & PAGE_USER))
+		page_protect_user(p->page_directory, page, flags);
+
+	return KERNEL_OK;
+}
+
+uint32_t
+vm_mmap(process_t *p, uint32_t addr, uint32_t length, uint32_t prot,
+	uint32_t flags, struct node *file, uint32_t offset)
+{
+	struct vm_region *region;
+	uint32_t first_byte = 0;
+	paddr_t file_base = 0;
+	uint32_t size;
+	uint32_t start;
+
+	if (!p || length == 0 || length > VM_MMAP_END - VM_MMAP_BASE)
+		return 0;
+
+	if (prot & ~(uint32_t)(PROT_READ | PROT_WRITE | PROT_EXEC))
+		return 0;
+
+	if (file)
+	{
+		paddr_t data;
+
+		/* Served straight from the initrd: no write access, no copy. */
+		if ((flags & MAP_ANONYMOUS) || (prot & PROT_WRITE))
+			return 0;
+
+		if (file->type != TMPFS_FILE || !file->u.file.data
+		    || !IS_PAGE_ALIGNED(offset) || offset >= file->u.file.size
+		    || length > file->u.file.size - offset)
+			return 0;
+
+		data = VA2PA(file->u.file.data + offset);
+		first_byte = data & PAGE_MASK;
+		file_base = PAGE_ALIGN_DOWN(data);
+	}
+	else if (!(flags & MAP_ANONYMOUS)
+		 || !(flags & MAP_PRIVATE) == !(flags & MAP_SHARED))
+	{
+		/* Anonymous memory is either copied by fork() or shared. */
+		return 0;
+	}
+
+	size = PAGE_ALIGN_UP(first_byte + length);
+
+	if (flags & MAP_FIXED)
+	{
+		if (!IS_PAGE_ALIGNED(addr) || addr < VM_MMAP_BASE
+		    || addr >= VM_MMAP_END || size > VM_MMAP_END - addr)
+			return 0;
+
+		if (vm_munmap(p, addr, size) != KERNEL_OK)
+			return 0;
+
+		start = addr;
+	}
+	else
+	{
+		start = range_find(p, addr, size);
+		if (!start)
+			return 0;
+	}
+
+	region = object_pool_alloc(&region_pool);
+	if (!region)
+		return 0;
+
+	memset(region, 0, sizeof(*region));
+	region->start = start;
+	region->end = start + size;
+	region->prot = prot;
+	region->flags = flags;
+	region->file = file;
+	region->file_base = file_base;
+	region_insert(p, region);
+
+	/* Shared pages are allocated up front, for fork() to share them all. */
+	if (!file && (flags & MAP_SHARED))
+	{
+		for (uint32_t va = start; va < start + size; va += PAGE_SIZE)
+		{
+			if (region_map_page(p, region, va) != KERNEL_OK)
+			{
+				vm_munmap(p, start, size);
+				return 0;
+			}
+		}
+	}
+
+	return start + first_byte;
+}
+
+status_t
+vm_munmap(process_t *p, uint32_t addr, uint32_t length)
+{
+	struct vm_region *r;
+	struct vm_region *next;
+	uint32_t start = addr;
+	uint32_t end;
+
+	if (!p || length == 0 || !IS_PAGE_ALIGNED(addr)
+	    || addr >= KERNEL_VIRTUAL_BASE || length > KERNEL_VIRTUAL_BASE - addr)
+		return -KERNEL_INVALID_VALUE;
+
+	end = PAGE_ALIGN_UP(addr + length);
+
+	for (r = TAILQ_FIRST(&p->regions); r != NULL; r = next)
+	{
+		next = TAILQ_NEXT(r, next);
+
+		if (r->end <= start || r->start >= end)
+			continue;
+
+		if (r->start < start)
+		{
+			r = region_split(p, r, start);
+			if (!r)
+				return -KERNEL_NO_MEMORY;
+		}
+
+		if (r->end > end && !region_split(p, r, end))
+			return -KERNEL_NO_MEMORY;
+
+		next = TAILQ_NEXT(r, next);
+
+		region_unmap_pages(p, r);
+		TAILQ_REMOVE(&p->regions, r, next);
+		object_pool_free(&region_pool, r);
+	}
+
+	return KERNEL_OK;
+}
+
+status_t
+vm_mprotect(process_t *p, uint32_t addr, uint32_t length, uint32_t prot)
+{
+	struct vm_region *r;
+	uint32_t end;
+	uint32_t covered;
+
+	if (!p || length == 0 || !IS_PAGE_ALIGNED(addr)
+	    || addr >= KERNEL_VIRTUAL_BASE || length > KERNEL_VIRTUAL_BASE - addr)
+		return -KERNEL_INVALID_VALUE;
+
+	if (prot & ~(uint32_t)(PROT_READ | PROT_WRITE | PROT_EXEC))
+		return -KERNEL_INVALID_VALUE;
+
+	end = PAGE_ALIGN_UP(addr + length);
+
+	/* The whole range must be mapped, and file pages stay read-only. */
+	covered = addr;
+	TAILQ_FOREACH(r, &p->regions, next)
+	{
+		if (r->end <= covered)
+			continue;
+
+		if (r->start > covered || covered >= end)
+			break;
+
+		if (r->file && (prot & PROT_WRITE))
+			return -KERNEL_PERMISSION_ERROR;
+
+		covered = r->end;
+	}
+
+	if (covered < end)
+		return -KERNEL_UNRESOLVED_VIRTUAL_ADDRESS;
+
+	for (r = region_find(p, addr); r != NULL && r->start < end;
+	     r = TAILQ_NEXT(r, next))
+	{
+		if (r->start < addr)
+		{
+			r = region_split(p, r, addr);
+			if (!r)
+				return -KERNEL_NO_MEMORY;
+		}
+
+		if (r->end > end && !region_split(p, r, end))
+			return -KERNEL_NO_MEMORY;
+
+		r->prot = prot;
+
+		for (uint32_t va = r->start; va < r->end; va += PAGE_SIZE)
+			page_protect_user(p->page_directory, va,
+					  prot_to_page_flags(prot));
+	}
+
+	return KERNEL_OK;
+}
+
+status_t
+vm_fault(process_t *p, uint32_t addr, bool write)
+{
+	struct vm_region *r;
+
+	if (!p || !p->page_directory)
+		return -KERNEL_INVALID_VALUE;
+
+	r = region_find(p, addr);
+	if (!r)
+		return -KERNEL_UNRESOLVED_VIRTUAL_ADDRESS;
+
+	if (!(r->prot & (PROT_READ | PROT_WRITE))
+	    || (write && !(r->prot & PROT_WRITE)))
+		return -KERNEL_PERMISSION_ERROR;
+
+	return region_map_page(p, r, PAGE_ALIGN_DOWN(addr));
+}
+
+paddr_t
+vm_user_frame(process_t *p, uint32_t addr, bool write)
+{
+	struct vm_region *r;
+	paddr_t frame;
+
+	if (!p || !p->page_directory || addr >= KERNEL_VIRTUAL_BASE)
+		return 0;
+
+	r = region_find(p, addr);
+
+	/* Outside mmap regions: the ELF image and stack, mapped up front. */
+	if (!r)
+		return page_lookup(p->page_directory, addr);
+
+	if (!(r->prot & (PROT_READ | PROT_WRITE))
+	    || (write && !(r->prot & PROT_WRITE)))
+		return 0;
+
+	frame = page_lookup(p->page_directory, addr);
+
+	if (!frame && vm_fault(p, addr, write) == KERNEL_OK)
+		frame = page_lookup(p->page_directory, addr);
+
+	return frame;
+}
+
+status_t
+vm_fork(process_t *parent, process_t *child)
+{
+	struct vm_region *r;
+
+	TAILQ_FOREACH(r, &parent->regions, next)
+	{
+		struct vm_region *copy = object_pool_alloc(&region_pool);
+
+		if (!copy)
+		{
+			vm_release(child);
+			return -KERNEL_NO_MEMORY;
+		}
+
+		memcpy(copy, r, sizeof(*copy));
+		TAILQ_INSERT_TAIL(&child->regions, copy, next);
+	}
+
+	return KERNEL_OK;
+}
+
+void
+vm_release(process_t *p)
+{
+	struct vm_region *r;
+
+	/* Frames are owned by the page directory and freed with it. */
+	while ((r = TAILQ_FIRST(&p->regions)) != NULL)
+	{
+		TAILQ_REMOVE(&p->regions, r, next);
+		object_pool_free(&region_pool, r);
+	}
+}
+
+static void
+vm_page_fault(struct registers *regs)
+{
+	thread_t *current = thread_get_current();
+	process_t *p = current->process;
+	uint32_t addr;
+
+	asm volatile("mov %%cr2, %0" : "=r"(addr));
+
+	kernel_lock();
+
+	if (p && addr < KERNEL_VIRTUAL_BASE
+	    && !(regs->error_code & PF_PROTECTION)
+	    && vm_fault(p, addr, regs->error_code & PF_WRITE) == KERNEL_OK)
+	{
+		kernel_unlock();
+		return;
+	}
+
+	if (p && (regs->error_code & PF_USER))
+	{
+		kprintf("%s: segmentation fault at %p (eip %p)\n",
+			current->name, (void *)addr, (void *)regs->eip);
+		process_exit(p, -1);
+	}
+
+	kprintf("Kernel page fault at %p (eip %p, error %x)\n",
+		(void *)addr, (void *)regs->eip, regs->error_code);
+
+	while (1)
+	{
+		asm("cli; hlt");
+	}
+}
+
+void
+vm_setup(void)
+{
+	status_t status = object_pool_init(&region_pool, "vm-region",
+			sizeof(struct vm_region), NULL, NULL);
+	assert(status == KERNEL_OK);
+
+	isr_set_handler(PAGE_FAULT, vm_page_fault);
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * User address space regions created by mmap().
+ */
+
+#pragma once
+
+#include <lib/types.h>
+#include <lib/queue.h>
+#include <lib/status.h>
+#include <lib/c/stdbool.h>
+
+/* Window of the user address space handed out by mmap(). */
+#define VM_MMAP_BASE	0x40000000u
+#define VM_MMAP_END	0xB0000000u
+
+/* Protection bits (mmap/mprotect). PROT_EXEC is accepted but not enforced. */
+#define PROT_NONE	0x0
+#define PROT_READ	0x1
+#define PROT_WRITE	0x2
+#define PROT_EXEC	0x4
+
+/* Mapping flags (mmap). */
+#define MAP_SHARED	0x01
+#define MAP_PRIVATE	0x02
+#define MAP_FIXED	0x10
+#define MAP_ANONYMOUS	0x20
+
+struct process;
+struct node;
+
+/*
+ * A contiguous, page-aligned range of a process address space.
+ *
+ * Private anonymous regions are zero-filled on first touch, and copied by
+ * fork(). Shared ones are zero-filled when mapped, and fork() shares their
+ * pages with the child. File regions map the initrd pages that hold the
+ * tarfs file data; file_base is the physical address backing the first
+ * page of the region.
+ */
+struct vm_region
+{
+	uint32_t	start;
+	uint32_t	end;		/* exclusive */
+	uint32_t	prot;
+	uint32_t	flags;
+	struct node	*file;		/* NULL for anonymous memory */
+	paddr_t		file_base;
+	TAILQ_ENTRY(vm_region) next;	/* sorted by start */
+};
+
+TAILQ_HEAD(vm_region_list, vm_region);
+
+/* Argument block of SYS_MMAP (ebx points to it in user memory). */
+struct mmap_args
+{
+	uint32_t addr;
+	uint32_t length;
+	uint32_t prot;
+	uint32_t flags;
+	uint32_t path;		/* user pointer to a tarfs path, file mappings */
+	uint32_t offset;
+};
+
+// Install the page fault handler.
+void vm_setup(void);
+
+/**
+ * Create a mapping in the address space of p.
+ *
+ * @return the user address of the first mapped byte, or 0 on failure. For a
+ * file whose data does not start on a page boundary in the initrd, the
+ * returned address carries the same offset within its page.
+ */
+uint32_t vm_mmap(struct process *p, uint32_t addr, uint32_t length,
+		 uint32_t prot, uint32_t flags, struct node *file,
+		 uint32_t offset);
+status_t vm_munmap(struct process *p, uint32_t addr, uint32_t length);
+status_t vm_mprotect(struct process *p, uint32_t addr, uint32_t length,
+		     uint32_t prot);
+
+/* Populate the page holding addr, as a page fault would. */
+status_t vm_fault(struct process *p, uint32_t addr, bool write);
+
+/*
+ * Physical frame backing a user byte, faulting it in if needed. Returns 0
+ * when the access is not allowed.
+ */
+paddr_t vm_user_frame(struct process *p, uint32_t addr, bool write);
+
+status_t vm_fork(struct process *parent, struct process *child);
+void vm_release(struct process *p);
@@ -62,6 +62,34 @@ enum Elf_Type {
 	ET_EXEC		= 2  // Executable File
 };
 
+typedef struct {
+	Elf32_Word	sh_name;
+	Elf32_Word	sh_type;
+	Elf32_Word	sh_flags;
+	Elf32_Addr	sh_addr;
+	Elf32_Off	sh_offset;
+	Elf32_Word	sh_size;
+	Elf32_Word	sh_link;
+	Elf32_Word	sh_info;
+	Elf32_Word	sh_addralign;
+	Elf32_Word	sh_entsize;
+} Elf32_Shdr;
+
+#define SHT_SYMTAB	2
+#define SHT_STRTAB	3
+
+typedef struct {
+	Elf32_Word	st_name;
+	Elf32_Addr	st_value;
+	Elf32_Word	st_size;
+	uint8_t		st_info;
+	uint8_t		st_other;
+	Elf32_Half	st_shndx;
+} Elf32_Sym;
+
+#define ELF32_ST_TYPE(info)	((info) & 0xf)
+#define STT_FUNC	2
+
 #define EM_386		(3)  // x86 Machine Type
 #define EV_CURRENT	(1)  // ELF Current Version
 
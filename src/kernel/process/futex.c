@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/types.h>
+#include <lib/queue.h>
+#include <lib/c/string.h>
+#include <lib/c/stdbool.h>
+#include <arch/x86/paging.h>
+#include <memory/frame.h>
+#include <memory/vm.h>
+
+#include "futex.h"
+#include "wait_queue.h"
+
+#define FUTEX_HASH_SIZE	64	/* a power of 2 */
+
+struct futex_waiter
+{
+	TAILQ_ENTRY(futex_waiter) next;	/* in its bucket */
+	uint32_t		key;	/* physical address of the word */
+	bool			queued;	/* in its bucket */
+	wait_queue_t		queue;	/* of one */
+};
+
+TAILQ_HEAD(futex_bucket, futex_waiter);
+
+static struct futex_bucket buckets[FUTEX_HASH_SIZE];
+static bool buckets_ready;
+
+static struct futex_bucket *
+bucket_of(uint32_t key)
+{
+	uint32_t i;
+
+	if (!buckets_ready)
+	{
+		for (i = 0; i < FUTEX_HASH_SIZE; i++)
+			TAILQ_INIT(&buckets[i]);
+		buckets_ready = true;
+	}
+
+	// Words are aligned, and neighbours often belong together
+	i = (key >> 2) ^ (key >> 12);
+
+	return &buckets[i & (FUTEX_HASH_SIZE - 1)];
+}
+
+/*
+ * Physical address of the word at uaddr. fork() copies private pages right
+ * away, there being no copy-on-write, but compaction may move them: see
+ * futex_pin().
+ */
+static status_t
+futex_key(process_t *p, uint32_t uaddr, uint32_t *key)
+{
+	paddr_t frame;
+
+	if (uaddr & (sizeof(uint32_t) - 1))
+		return -KERNEL_INVALID_VALUE;
+
+	frame = vm_user_frame(p, uaddr, false);
+	if (!frame)
+		return -KERNEL_INVALID_VALUE;
+
+	*key = (frame & ~(paddr_t)PAGE_MASK) | (uaddr & PAGE_MASK);
+	return KERNEL_OK;
+}
+
+/*
+ * Keep the frame of a sleeper's word in place, for futex_wake() to find it
+ * at the same key: compaction only moves frames referenced once.
+ */
+static void
+futex_pin(uint32_t key)
+{
+	frame_ref(key & ~(paddr_t)PAGE_MASK);
+}
+
+static void
+futex_unpin(uint32_t key)
+{
+	frame_free(key & ~(paddr_t)PAGE_MASK);
+}
+
+status_t
+futex_wait(process_t *p, uint32_t uaddr, uint32_t value, uint64_t timeout_ns)
+{
+	struct futex_waiter waiter;
+	status_t status;
+
+	status = futex_key(p, uaddr, &waiter.key);
+	if (status != KERNEL_OK)
+		return status;
+
+	// futex_wake() cannot run in between: it takes the kernel lock too
+	if (*(volatile uint32_t *)PA2VA(waiter.key) != value)
+		return -KERNEL_BUSY;
+
+	futex_pin(waiter.key);
+	waiter.queued = true;
+	wait_queue_init(&waiter.queue);
+	wait_queue_prepare(&waiter.queue, false);
+	TAILQ_INSERT_TAIL(bucket_of(waiter.key), &waiter, next);
+
+	status = wait_queue_sleep(&waiter.queue, timeout_ns);
+
+	// Timed out: futex_wake() leaves us be, maybe on another bucket
+	if (waiter.queued)
+		TAILQ_REMOVE(bucket_of(waiter.key), &waiter, next);
+
+	futex_unpin(waiter.key);
+
+	return status;
+}
+
+// Wake up to count sleepers on key, and move up to requeue_count to key2.
+static int
+futex_wake_key(uint32_t key, uint32_t count, uint32_t key2,
+	       uint32_t requeue_count)
+{
+	struct futex_bucket *bucket = bucket_of(key);
+	struct futex_waiter *waiter, *next;
+	uint32_t woken = 0;
+
+	for (waiter = TAILQ_FIRST(bucket); waiter; waiter = next)
+	{
+		next = TAILQ_NEXT(waiter, next);
+
+		// Timed out, and on its way to leave
+		if (waiter->key != key || TAILQ_EMPTY(&waiter->queue.threads))
+			continue;
+
+		if (woken < count)
+		{
+			TAILQ_REMOVE(bucket, waiter, next);
+			waiter->queued = false;
+			wait_queue_wake_all(&waiter->queue);
+			woken++;
+		}
+		else if (requeue_count > 0)
+		{
+			TAILQ_REMOVE(bucket, waiter, next);
+			futex_pin(key2);
+			futex_unpin(waiter->key);
+			waiter->key = key2;
+			TAILQ_INSERT_TAIL(bucket_of(key2), waiter, next);
+			requeue_count--;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	return (int)woken;
+}
+
+int
+futex_wake(process_t *p, uint32_t uaddr, uint32_t count)
+{
+	uint32_t key;
+	status_t status = futex_key(p, uaddr, &key);
+
+	if (status != KERNEL_OK)
+		return status;
+
+	return futex_wake_key(key, count, 0, 0);
+}
+
+int
+futex_requeue(process_t *p, uint32_t uaddr, uint32_t count, uint32_t uaddr2,
+	      uint32_t requeue_count)
+{
+	uint32_t key, key2;
+	status_t status;
+
+	if ((status = futex_key(p, uaddr, &key)) != KERNEL_OK
+	    || (status = futex_key(p, uaddr2, &key2)) != KERNEL_OK)
+		return status;
+
+	// Moving waiters to their own bucket would visit them forever
+	if (key == key2)
+		requeue_count = 0;
+
+	return futex_wake_key(key, count, key2, requeue_count);
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Fast user-space mutexes: user code synchronizes with atomic operations
+ * on a 32-bit word, and only calls in the kernel to sleep until the word
+ * changes or to wake up the sleepers. Words are told apart by physical
+ * address, so that processes sharing a page share its futexes.
+ *
+ * Called under the kernel lock, which protects the waiters.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+#include <lib/status.h>
+#include <process/process.h>
+
+/*
+ * Sleep if the word at uaddr holds value, until futex_wake() or for at
+ * most timeout_ns nanoseconds unless 0. Returns KERNEL_OK once woken,
+ * -KERNEL_BUSY if the word held something else, -KERNEL_TIMED_OUT, or
+ * -KERNEL_INVALID_VALUE for an unaligned or unreadable address.
+ */
+status_t futex_wait(process_t *p, uint32_t uaddr, uint32_t value,
+		    uint64_t timeout_ns);
+
+// Wake up to count sleepers on uaddr. Returns how many, or a status.
+int futex_wake(process_t *p, uint32_t uaddr, uint32_t count);
+
+/*
+ * Wake up to count sleepers on uaddr and move up to requeue_count others
+ * to uaddr2, to be woken from there. Returns how many were woken, or a
+ * status.
+ */
+int futex_requeue(process_t *p, uint32_t uaddr, uint32_t count,
+		  uint32_t uaddr2, uint32_t requeue_count);
@@ -9,9 +9,10 @@
 #include <lib/types.h>
 #include <lib/c/stdlib.h>
 #include <lib/c/string.h>
-#include <arch/x86/irq.h>
 #include <process/thread.h>
-#include <process/scheduler.h>
+#include <arch/x86/atomic.h>
+#include <arch/x86/kernel_lock.h>
+#include <arch/x86/percpu.h>
 
 #include "mutex.h"
 
@@ -24,8 +25,8 @@ mutex_create(void)
 		return NULL;
 
 	mtx->owner = NULL;
-	mtx->count = 0;
-	TAILQ_INIT(&mtx->waitqueue);
+	atomic_set(&mtx->state, MUTEX_UNLOCKED);
+	wait_queue_init(&mtx->waitqueue);
 
 	return mtx;
 }
@@ -33,63 +34,129 @@ mutex_create(void)
 void
 mutex_destroy(mutex_t *mtx)
 {
-	thread_t *item;
+	free(mtx);
+}
+
+static bool
+mutex_try_lock(mutex_t *mtx, thread_t *current_thread)
+{
+	if (atomic_cmpxchg(&mtx->state, MUTEX_UNLOCKED, MUTEX_LOCKED)
+	    != MUTEX_UNLOCKED)
+		return false;
+
+	mtx->owner = current_thread;
+	return true;
+}
+
+/*
+ * Whether we own it, handed over by mutex_unlock(), or took it. Past this,
+ * unlock goes the slow way and looks for waiters.
+ */
+static bool
+mutex_lock_contended(mutex_t *mtx, thread_t *current_thread)
+{
+	if (mtx->owner == current_thread)
+		return true;
 
-	while ((item = TAILQ_FIRST(&mtx->waitqueue)))
+	if (atomic_xchg(&mtx->state, MUTEX_CONTENDED) != MUTEX_UNLOCKED)
+		return false;
+
+	mtx->owner = current_thread;
+	return true;
+}
+
+/*
+ * Spin while the owner runs, which is on another CPU since we do. Nobody
+ * owns it for a short while when it has just been taken or is being
+ * released. Gives up when this CPU has something else to run.
+ */
+static bool
+mutex_spin(mutex_t *mtx, thread_t *current_thread)
+{
+	bool locked = false;
+	uint32_t depth = kernel_lock_drop();
+
+	for (uint32_t spins = 0; spins < MUTEX_SPIN_LIMIT; spins++)
 	{
-		TAILQ_REMOVE(&mtx->waitqueue, item, next);
+		thread_t *owner = mtx->owner;
+
+		if (atomic_read(&mtx->state) == MUTEX_UNLOCKED
+		    && mutex_try_lock(mtx, current_thread))
+		{
+			locked = true;
+			break;
+		}
+
+		if ((owner && owner->state != THREAD_RUNNING)
+		    || cpu_current()->need_resched)
+			break;
+
+		asm volatile("pause" ::: "memory");
 	}
 
-	free(mtx);
+	kernel_lock_retake(depth);
+
+	return locked;
 }
 
 status_t
-mutex_lock(mutex_t *mtx)
+mutex_lock_timeout(mutex_t *mtx, uint64_t timeout_ns)
 {
-	status_t status = KERNEL_OK;
+	thread_t *current_thread = thread_get_current();
 
-	atomic_inc(mtx->count);
+	if (mtx->owner == current_thread)
+		return -KERNEL_BUSY;
 
-	// Mutex already owned?
-	if (mtx->owner != NULL)
-	{
-		thread_t *current_thread = thread_get_current();
+	if (mutex_try_lock(mtx, current_thread)
+	    || mutex_spin(mtx, current_thread))
+		return KERNEL_OK;
 
-		if (mtx->owner == current_thread)
-			status = -KERNEL_BUSY;
-		else
-			TAILQ_INSERT_TAIL(&mtx->waitqueue, current_thread, next);
-	}
+	return wait_event_exclusive_timeout(&mtx->waitqueue,
+		mutex_lock_contended(mtx, current_thread), timeout_ns);
+}
 
-	return status;
+status_t
+mutex_lock(mutex_t *mtx)
+{
+	return mutex_lock_timeout(mtx, 0);
 }
 
 status_t
 mutex_unlock(mutex_t *mtx)
 {
-	status_t status;
-
-	atomic_dec(mtx->count);
+	wait_queue_t *wq = &mtx->waitqueue;
+	thread_t *waiter;
+	uint32_t flags;
 
 	if (mtx->owner != thread_get_current())
+		return -KERNEL_PERMISSION_ERROR;
+
+	mtx->owner = NULL;
+
+	if (atomic_cmpxchg(&mtx->state, MUTEX_LOCKED, MUTEX_UNLOCKED)
+	    == MUTEX_LOCKED)
+		return KERNEL_OK;
+
+	// Waiters get on the queue before they mark it contended
+	spin_lock_irqsave(&wq->lock, flags);
+
+	waiter = TAILQ_FIRST(&wq->threads);
+
+	if (!waiter)
 	{
-		status = -KERNEL_PERMISSION_ERROR;
-	}
-	else if (TAILQ_EMPTY(&mtx->waitqueue))
-	{
-		mtx->owner = NULL;
-		status = KERNEL_OK;
+		// Waiters timed out
+		atomic_set(&mtx->state, MUTEX_UNLOCKED);
 	}
 	else
 	{
-		thread_t *blocked_thread = TAILQ_FIRST(&mtx->waitqueue);
-		TAILQ_REMOVE(&mtx->waitqueue, blocked_thread, next);
+		mtx->owner = waiter;
+		wait_queue_wake_locked(wq, waiter);
 
-		if (blocked_thread->state != THREAD_RUNNING)
-			scheduler_insert_thread(blocked_thread);
-
-		status = KERNEL_OK;
+		if (TAILQ_EMPTY(&wq->threads))
+			atomic_set(&mtx->state, MUTEX_LOCKED);
 	}
 
-	return status;
+	spin_unlock_irqrestore(&wq->lock, flags);
+
+	return KERNEL_OK;
 }
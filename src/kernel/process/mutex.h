@@ -10,17 +10,37 @@
 #include <lib/queue.h>
 #include <lib/types.h>
 #include <process/thread.h>
+#include <process/wait_queue.h>
 #include <arch/x86/atomic.h>
-#include "semaphore.h"
+
+/*
+ * An uncontended mutex is taken and released with a single cmpxchg. A
+ * contended one is first spun on while its owner runs on another CPU, as
+ * it is likely to be released soon, then slept on: unlock hands it over to
+ * the first waiter, so that nobody takes it from under the thread woken up
+ * for it.
+ */
+#define MUTEX_UNLOCKED	0
+#define MUTEX_LOCKED	1
+#define MUTEX_CONTENDED	2	/* locked, and there may be waiters */
+
+// Pauses spent at most spinning on a running owner
+#define MUTEX_SPIN_LIMIT	10000
 
 typedef struct
 {
-	thread_t		*owner;
-	volatile atomic_count_t	count;
-	TAILQ_HEAD(, thread)	waitqueue;
+	thread_t * volatile	owner;
+	atomic_t		state;
+	wait_queue_t		waitqueue;
 } mutex_t;
 
 mutex_t *mutex_create(void);
 void mutex_destroy(mutex_t *mtx);
 status_t mutex_lock(mutex_t *mtx);
 status_t mutex_unlock(mutex_t *mtx);
+
+/*
+ * Like mutex_lock(), giving up after timeout_ns nanoseconds (0 waits
+ * forever) with -KERNEL_TIMED_OUT.
+ */
+status_t mutex_lock_timeout(mutex_t *mtx, uint64_t timeout_ns);
@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/c/assert.h>
+#include <lib/c/string.h>
+#include <arch/x86/spinlock.h>
+
+#include "pi_mutex.h"
+#include "scheduler.h"
+#include "wait_queue.h"
+
+/*
+ * The owner word holds the owning thread, whose low bit is free: set, it
+ * tells unlock to go the slow way. Waiters, boosts and the slow paths are
+ * all under pi_lock, so that a chain of owners is walked without taking
+ * the locks along it in some order.
+ */
+#define PI_HAS_WAITERS	0x1
+
+// Priorities of SCHED_NORMAL threads are below, by nice value
+#define PI_PRIO_RT	(THREAD_NICE_MAX - THREAD_NICE_MIN + 1)
+
+struct pi_waiter
+{
+	TAILQ_ENTRY(pi_waiter)	next;
+	thread_t		*thread;
+	pi_mutex_t		*mutex;
+	uint32_t		prio;	/* of thread, when last queued */
+	wait_queue_t		wait;	/* of one */
+};
+
+static spinlock_t pi_lock = SPINLOCK_INITIALIZER;
+
+// The higher, the more urgent.
+static uint32_t
+pi_prio(uint32_t policy, uint32_t rt_priority, int nice)
+{
+	if (policy != SCHED_NORMAL)
+		return PI_PRIO_RT + rt_priority;
+
+	return (uint32_t)(THREAD_NICE_MAX - nice);
+}
+
+static uint32_t
+current_prio(const thread_t *t)
+{
+	return pi_prio(t->policy, t->rt_priority, t->nice);
+}
+
+// Its own priority, or that of its most urgent waiter.
+static uint32_t
+boosted_prio(thread_t *t)
+{
+	uint32_t prio = pi_prio(t->base_policy, t->base_rt_priority,
+				t->base_nice);
+	pi_mutex_t *m;
+
+	LIST_FOREACH(m, &t->pi_held, held)
+	{
+		struct pi_waiter *top = TAILQ_FIRST(&m->waiters);
+
+		if (top->prio > prio)
+			prio = top->prio;
+	}
+
+	return prio;
+}
+
+// A SCHED_NORMAL thread is made SCHED_FIFO to inherit a real-time one.
+static void
+set_prio(thread_t *t, uint32_t prio)
+{
+	if (prio >= PI_PRIO_RT)
+	{
+		uint32_t policy = t->base_policy != SCHED_NORMAL
+			? t->base_policy : SCHED_FIFO;
+
+		scheduler_set_nice(t, t->base_nice);
+		scheduler_set_policy(t, policy, prio - PI_PRIO_RT);
+	}
+	else
+	{
+		scheduler_set_policy(t, SCHED_NORMAL, 0);
+		scheduler_set_nice(t, THREAD_NICE_MAX - (int)prio);
+	}
+}
+
+static thread_t *
+owner_of(pi_mutex_t *m)
+{
+	return (thread_t *)(atomic_read(&m->owner) & ~PI_HAS_WAITERS);
+}
+
+static void
+enqueue_waiter(pi_mutex_t *m, struct pi_waiter *waiter)
+{
+	struct pi_waiter *w;
+
+	// Behind those of the same priority
+	TAILQ_FOREACH(w, &m->waiters, next)
+	{
+		if (w->prio < waiter->prio)
+		{
+			TAILQ_INSERT_BEFORE(w, waiter, next);
+			return;
+		}
+	}
+
+	TAILQ_INSERT_TAIL(&m->waiters, waiter, next);
+}
+
+/*
+ * Give t the priority it should have now, and pass the change on along
+ * the owners it waits for. Called with pi_lock held; force for t having
+ * new attributes of its own, which may come to the same priority.
+ */
+static void
+adjust_chain(thread_t *t, bool force)
+{
+	for (uint32_t depth = 0; t && depth < PI_CHAIN_MAX; depth++)
+	{
+		struct pi_waiter *waiter = t->pi_blocked_on;
+		uint32_t prio = boosted_prio(t);
+
+		if (prio == current_prio(t) && !force)
+			break;
+
+		force = false;
+
+		set_prio(t, prio);
+
+		if (!waiter)
+			break;
+
+		TAILQ_REMOVE(&waiter->mutex->waiters, waiter, next);
+		waiter->prio = prio;
+		enqueue_waiter(waiter->mutex, waiter);
+
+		t = owner_of(waiter->mutex);
+	}
+}
+
+void
+pi_mutex_init(pi_mutex_t *m)
+{
+	atomic_set(&m->owner, 0);
+	TAILQ_INIT(&m->waiters);
+}
+
+bool
+pi_mutex_trylock(pi_mutex_t *m)
+{
+	return atomic_cmpxchg(&m->owner, 0,
+			      (int32_t)thread_get_current()) == 0;
+}
+
+/*
+ * Take m if it is free, else flag it for unlock to come to pi_lock.
+ * Returns whether it was taken.
+ */
+static bool
+take_or_flag(pi_mutex_t *m, thread_t *current)
+{
+	for (;;)
+	{
+		int32_t owner = atomic_read(&m->owner);
+
+		if (owner == 0)
+		{
+			if (atomic_cmpxchg(&m->owner, 0, (int32_t)current) == 0)
+				return true;
+		}
+		else if ((owner & PI_HAS_WAITERS)
+			 || atomic_cmpxchg(&m->owner, owner,
+					   owner | PI_HAS_WAITERS) == owner)
+		{
+			return false;
+		}
+	}
+}
+
+status_t
+pi_mutex_lock(pi_mutex_t *m)
+{
+	thread_t *current = thread_get_current();
+	struct pi_waiter waiter;
+	thread_t *owner;
+	uint32_t flags;
+
+	if (pi_mutex_trylock(m))
+		return KERNEL_OK;
+
+	if (owner_of(m) == current)
+		return -KERNEL_BUSY;
+
+	spin_lock_irqsave(&pi_lock, flags);
+
+	if (take_or_flag(m, current))
+	{
+		spin_unlock_irqrestore(&pi_lock, flags);
+		return KERNEL_OK;
+	}
+
+	owner = owner_of(m);
+
+	waiter.thread = current;
+	waiter.mutex = m;
+	waiter.prio = current_prio(current);
+	wait_queue_init(&waiter.wait);
+
+	if (TAILQ_EMPTY(&m->waiters))
+		LIST_INSERT_HEAD(&owner->pi_held, m, held);
+
+	enqueue_waiter(m, &waiter);
+	current->pi_blocked_on = &waiter;
+
+	adjust_chain(owner, false);
+
+	// Queued before letting go of pi_lock: the handover cannot be missed
+	wait_queue_prepare(&waiter.wait, false);
+	spin_unlock_irqrestore(&pi_lock, flags);
+
+	wait_queue_sleep(&waiter.wait, 0);
+
+	// pi_mutex_unlock() made us the owner before waking us up
+	assert(owner_of(m) == current);
+
+	return KERNEL_OK;
+}
+
+status_t
+pi_mutex_unlock(pi_mutex_t *m)
+{
+	thread_t *current = thread_get_current();
+	struct pi_waiter *top;
+	uint32_t flags;
+
+	if (owner_of(m) != current)
+		return -KERNEL_PERMISSION_ERROR;
+
+	if (atomic_cmpxchg(&m->owner, (int32_t)current, 0)
+	    == (int32_t)current)
+		return KERNEL_OK;
+
+	spin_lock_irqsave(&pi_lock, flags);
+
+	top = TAILQ_FIRST(&m->waiters);
+	assert(top != NULL);
+
+	LIST_REMOVE(m, held);
+	TAILQ_REMOVE(&m->waiters, top, next);
+	top->thread->pi_blocked_on = NULL;
+
+	// Hand it over, the new owner inheriting from the waiters left
+	if (TAILQ_EMPTY(&m->waiters))
+	{
+		atomic_set(&m->owner, (int32_t)top->thread);
+	}
+	else
+	{
+		atomic_set(&m->owner, (int32_t)top->thread | PI_HAS_WAITERS);
+		LIST_INSERT_HEAD(&top->thread->pi_held, m, held);
+		adjust_chain(top->thread, false);
+	}
+
+	wait_queue_wake_all(&top->wait);
+
+	// Back to what we had without m
+	adjust_chain(current, false);
+
+	spin_unlock_irqrestore(&pi_lock, flags);
+
+	return KERNEL_OK;
+}
+
+status_t
+pi_set_policy(thread_t *t, uint32_t policy, uint32_t priority)
+{
+	uint32_t flags;
+
+	if (!scheduler_policy_valid(policy, priority))
+		return -KERNEL_INVALID_VALUE;
+
+	spin_lock_irqsave(&pi_lock, flags);
+
+	t->base_policy = policy;
+	t->base_rt_priority = priority;
+	adjust_chain(t, true);
+
+	spin_unlock_irqrestore(&pi_lock, flags);
+
+	return KERNEL_OK;
+}
+
+status_t
+pi_set_nice(thread_t *t, int nice)
+{
+	uint32_t flags;
+
+	if (nice < THREAD_NICE_MIN || nice > THREAD_NICE_MAX)
+		return -KERNEL_INVALID_VALUE;
+
+	spin_lock_irqsave(&pi_lock, flags);
+
+	t->base_nice = nice;
+	adjust_chain(t, true);
+
+	spin_unlock_irqrestore(&pi_lock, flags);
+
+	return KERNEL_OK;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Priority-inheriting mutexes, for locks that urgent threads take.
+ *
+ * The owner of a contended pi_mutex_t runs at the priority of its most
+ * urgent waiter, if that is higher than its own, until it unlocks: a
+ * thread of middle priority cannot hold it off, and the waiter with it.
+ * If the owner itself waits for another pi_mutex_t, the boost carries on
+ * to that one's owner, and so on.
+ *
+ * Waiters queue by priority, and unlock hands the mutex over to the first
+ * one. Uncontended, taking and releasing are a single cmpxchg each.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+#include <lib/queue.h>
+#include <lib/status.h>
+#include <lib/c/stdbool.h>
+#include <arch/x86/atomic.h>
+
+#include "thread.h"
+
+// Longest chain of owners boosted, against deadlocked ones
+#define PI_CHAIN_MAX	16
+
+TAILQ_HEAD(pi_waiter_queue, pi_waiter);
+
+typedef struct pi_mutex
+{
+	atomic_t		owner;		/* thread_t *, | PI_HAS_WAITERS */
+	struct pi_waiter_queue	waiters;	/* most urgent first */
+	LIST_ENTRY(pi_mutex)	held;		/* on its owner's, if waiters */
+} pi_mutex_t;
+
+#define PI_MUTEX_INITIALIZER(m) \
+	{ ATOMIC_INIT(0), TAILQ_HEAD_INITIALIZER((m).waiters), { 0, 0 } }
+
+void pi_mutex_init(pi_mutex_t *m);
+status_t pi_mutex_lock(pi_mutex_t *m);
+// Returns whether m was taken.
+bool pi_mutex_trylock(pi_mutex_t *m);
+status_t pi_mutex_unlock(pi_mutex_t *m);
+
+/*
+ * scheduler_set_policy() and scheduler_set_nice(), for the attributes of
+ * t as set rather than as boosted: t keeps any boost it has above them.
+ */
+status_t pi_set_policy(thread_t *t, uint32_t policy, uint32_t priority);
+status_t pi_set_nice(thread_t *t, int nice);
@@ -4,7 +4,9 @@
 #include <lib/status.h>
 #include <arch/x86/paging.h>
 #include <arch/x86/syscall.h>
+#include <arch/x86/atomic.h>
 #include <memory/frame.h>
+#include <memory/object_pool.h>
 
 #include "process.h"
 #include "elf_loader.h"
@@ -17,24 +19,32 @@
 #define USER_STACK_BASE		(USER_STACK_TOP - (USER_STACK_PAGES - 1) * PAGE_SIZE)
 #define USER_STACK_ARG_MAX	32
 
-static int g_next_pid = 1;
+static atomic_t g_next_pid = ATOMIC_INIT(1);
 static process_t *g_init_process = NULL;
+static LIST_HEAD(, process) g_processes = LIST_HEAD_INITIALIZER(g_processes);
+static object_pool_t process_pool;
 
 void
 process_init(void)
 {
-	process_t *init = malloc(sizeof(process_t));
+	status_t status = object_pool_init(&process_pool, "process",
+			sizeof(process_t), NULL, NULL);
+	assert(status == KERNEL_OK);
+
+	process_t *init = object_pool_alloc(&process_pool);
 
 	assert(init != NULL);
 	memset(init, 0, sizeof(*init));
 
-	init->pid   = g_next_pid++;
+	init->pid   = atomic_fetch_add(&g_next_pid, 1);
 	init->ppid  = 0;
 	init->state = PROC_LIVE;
 	LIST_INIT(&init->children);
-	TAILQ_INIT(&init->waiters);
+	wait_queue_init(&init->waiters);
+	TAILQ_INIT(&init->regions);
 
 	g_init_process = init;
+	LIST_INSERT_HEAD(&g_processes, init, all);
 }
 
 process_t *
@@ -43,56 +53,85 @@ process_get_init(void)
 	return g_init_process;
 }
 
-void
-process_wake_waiters(process_t *parent)
+process_t *
+process_find(int pid)
 {
-	thread_t *t;
-
-	if (!parent)
-		return;
+	process_t *p;
 
-	while ((t = TAILQ_FIRST(&parent->waiters)) != NULL)
+	LIST_FOREACH(p, &g_processes, all)
 	{
-		TAILQ_REMOVE(&parent->waiters, t, next);
-		scheduler_insert_thread(t);
+		if (p->pid == pid)
+			return p->state == PROC_LIVE ? p : NULL;
 	}
+
+	return NULL;
 }
 
-int
-process_wait(process_t *parent, int *status)
+void
+process_wake_waiters(process_t *parent)
 {
-	process_t *child;
+	// Each may wait for another child: let them all look
+	if (parent)
+		wait_queue_wake_all(&parent->waiters);
+}
 
-	if (!parent)
-		return -1;
+/*
+ * Reap the child numbered pid, or any child if pid is -1, if it exited.
+ * Returns whether there is no need to wait, *ret being its pid, or -1 if
+ * there is no such child.
+ */
+static bool
+reap_child(process_t *parent, int pid, int *status, int *ret)
+{
+	process_t *child;
+	bool found = false;
 
-	for (;;)
+	LIST_FOREACH(child, &parent->children, sibling)
 	{
-		LIST_FOREACH(child, &parent->children, sibling)
+		if (pid != -1 && child->pid != pid)
+			continue;
+
+		found = true;
+
+		if (child->state == PROC_ZOMBIE)
 		{
-			if (child->state == PROC_ZOMBIE)
-			{
-				int pid = child->pid;
+			*ret = child->pid;
 
-				if (status)
-					*status = child->exit_status;
+			if (status)
+				*status = child->exit_status;
 
-				LIST_REMOVE(child, sibling);
-				free(child);
-				return pid;
-			}
+			LIST_REMOVE(child, sibling);
+			LIST_REMOVE(child, all);
+			object_pool_free(&process_pool, child);
+			return true;
 		}
+	}
 
-		if (LIST_EMPTY(&parent->children))
-			return -1;
+	*ret = -1;
+	return !found;
+}
 
-		thread_t *current = thread_get_current();
+int
+process_wait_timeout(process_t *parent, int pid, int *status,
+		     uint64_t timeout_ns)
+{
+	int ret;
 
-		current->state = THREAD_BLOCKED;
-		scheduler_remove_thread(current);
-		TAILQ_INSERT_TAIL(&parent->waiters, current, next);
-		schedule();
-	}
+	if (!parent)
+		return -1;
+
+	if (wait_event_timeout(&parent->waiters,
+			       reap_child(parent, pid, status, &ret),
+			       timeout_ns) != KERNEL_OK)
+		return 0;
+
+	return ret;
+}
+
+int
+process_wait(process_t *parent, int *status)
+{
+	return process_wait_timeout(parent, -1, status, 0);
 }
 
 /*
@@ -225,6 +264,8 @@ process_exit(process_t *p, int status)
 		p->page_directory = 0;
 	}
 
+	vm_release(p);
+
 	process_wake_waiters(p->parent);
 	thread_exit();
 }
@@ -240,6 +281,7 @@ process_exec_elf(process_t *p, const char *path, char *const argv[],
 		return -1;
 
 	page_directory_clear_user(p->page_directory);
+	vm_release(p);
 
 	if (process_image_load(p->page_directory, path, argv, root,
 			       &entry, &esp) != 0)
@@ -267,7 +309,7 @@ process_fork(process_t *parent, struct syscall_frame *frame)
 	if (!pd)
 		return -1;
 
-	child = malloc(sizeof(process_t));
+	child = object_pool_alloc(&process_pool);
 	if (!child)
 	{
 		page_directory_destroy(pd);
@@ -276,7 +318,7 @@ process_fork(process_t *parent, struct syscall_frame *frame)
 
 	memset(child, 0, sizeof(*child));
 
-	pid = g_next_pid++;
+	pid = atomic_fetch_add(&g_next_pid, 1);
 	child->pid = pid;
 	child->ppid = parent->pid;
 	child->parent = parent;
@@ -286,16 +328,27 @@ process_fork(process_t *parent, struct syscall_frame *frame)
 	child->cwd = parent->cwd;
 	memcpy(child->fds, parent->fds, sizeof(child->fds));
 	LIST_INIT(&child->children);
-	TAILQ_INIT(&child->waiters);
+	wait_queue_init(&child->waiters);
+	TAILQ_INIT(&child->regions);
+
+	if (vm_fork(parent, child) != KERNEL_OK)
+	{
+		page_directory_destroy(pd);
+		object_pool_free(&process_pool, child);
+		return -1;
+	}
 
 	LIST_INSERT_HEAD(&parent->children, child, sibling);
+	LIST_INSERT_HEAD(&g_processes, child, all);
 
 	t = thread_fork_create("fork", child, frame);
 	if (!t)
 	{
 		LIST_REMOVE(child, sibling);
+		LIST_REMOVE(child, all);
 		page_directory_destroy(pd);
-		free(child);
+		vm_release(child);
+		object_pool_free(&process_pool, child);
 		return -1;
 	}
 
@@ -327,7 +380,7 @@ process_create_from_elf(const char *path, struct node *root)
 	if (process_image_load(pd, path, argv, root, &entry, &esp) != 0)
 		goto fail_pd;
 
-	p = malloc(sizeof(process_t));
+	p = object_pool_alloc(&process_pool);
 	if (!p)
 		goto fail_pd;
 
@@ -343,7 +396,7 @@ process_create_from_elf(const char *path, struct node *root)
 
 	assert(parent != NULL);
 
-	p->pid            = g_next_pid++;
+	p->pid            = atomic_fetch_add(&g_next_pid, 1);
 	p->ppid           = parent->pid;
 	p->parent         = parent;
 	p->state          = PROC_LIVE;
@@ -356,9 +409,11 @@ process_create_from_elf(const char *path, struct node *root)
 	p->fds[2]         = FD_CONSOLE;
 	p->cwd            = root;
 	LIST_INIT(&p->children);
-	TAILQ_INIT(&p->waiters);
+	wait_queue_init(&p->waiters);
+	TAILQ_INIT(&p->regions);
 
 	LIST_INSERT_HEAD(&parent->children, p, sibling);
+	LIST_INSERT_HEAD(&g_processes, p, all);
 
 	t = thread_user_create(path, p);
 	if (!t)
@@ -368,7 +423,8 @@ process_create_from_elf(const char *path, struct node *root)
 
 fail_proc:
 	LIST_REMOVE(p, sibling);
-	free(p);
+	LIST_REMOVE(p, all);
+	object_pool_free(&process_pool, p);
 fail_pd:
 	page_directory_destroy(pd);
 	return NULL;
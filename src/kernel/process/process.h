@@ -3,8 +3,10 @@
 #include <lib/types.h>
 #include <lib/queue.h>
 #include <fs/tarfs.h>
+#include <memory/vm.h>
 
 #include "thread.h"
+#include "wait_queue.h"
 
 typedef enum { PROC_LIVE, PROC_ZOMBIE } proc_state;
 
@@ -24,15 +26,19 @@ typedef struct process {
 	struct process	*parent;
 	LIST_HEAD(, process) children;
 	LIST_ENTRY(process) sibling;	/* on parent's children */
-	TAILQ_HEAD(, thread) waiters;	/* parents blocked in wait */
+	LIST_ENTRY(process) all;	/* on the list of all processes */
+	wait_queue_t	waiters;	/* parents blocked in wait */
 	uint8_t		fds[PROC_NFDS];
 	struct node	*cwd;		/* current working directory in tarfs */
+	struct vm_region_list regions;	/* mmap() regions, sorted */
 } process_t;
 
 struct syscall_frame;
 
 void process_init(void);
 process_t *process_get_init(void);
+// The live process numbered pid, or NULL.
+process_t *process_find(int pid);
 process_t *process_create_from_elf(const char *path, struct node *root);
 int process_image_load(uint32_t pd, const char *path, char *const argv[],
 		       struct node *root, uint32_t *entry_out, uint32_t *esp_out);
@@ -41,4 +47,11 @@ int process_exec_elf(process_t *p, const char *path, char *const argv[],
 int process_fork(process_t *parent, struct syscall_frame *frame);
 void process_exit(process_t *p, int status) __attribute__((noreturn));
 int process_wait(process_t *parent, int *status);
+/*
+ * Reap the child numbered pid, or any child if pid is -1, waiting for it
+ * to exit for at most timeout_ns nanoseconds unless 0. Returns its pid,
+ * 0 on timeout, or -1 if there is no such child.
+ */
+int process_wait_timeout(process_t *parent, int pid, int *status,
+			 uint64_t timeout_ns);
 void process_wake_waiters(process_t *parent);
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/c/assert.h>
+#include <lib/c/stdbool.h>
+#include <arch/x86/percpu.h>
+#include <arch/x86/spinlock.h>
+#include <arch/x86/clock.h>
+#include <arch/x86/tick.h>
+
+#include "rcu.h"
+#include "wait_queue.h"
+#include "timer.h"
+
+/*
+ * Callbacks wait on pending until a grace period starts, then on waiting
+ * until it ends. A grace period starts with a snapshot of the quiescent
+ * state counts of the CPUs, and ends once each of them has moved or sits
+ * idle. A timer checks for that every tick while there is work.
+ */
+
+STAILQ_HEAD(rcu_list, rcu_head);
+
+static spinlock_t rcu_lock = SPINLOCK_INITIALIZER;
+static struct rcu_list pending = STAILQ_HEAD_INITIALIZER(pending);
+static struct rcu_list waiting = STAILQ_HEAD_INITIALIZER(waiting);
+static bool grace_period;
+static uint32_t snapshot[NB_CPUS];
+static struct timer rcu_timer;
+static bool rcu_timer_armed;
+
+// The CPU running this is in an interrupt, hence quiescent.
+static bool
+grace_period_over(uint32_t self)
+{
+	for (uint32_t i = 0; i < nb_cpus; i++)
+	{
+		if (i == self || !cpus[i].online)
+			continue;
+
+		if (cpus[i].rcu_qs == snapshot[i]
+		    && cpus[i].current_thread != cpus[i].idle_thread)
+			return false;
+	}
+
+	return true;
+}
+
+static void
+grace_period_start(void)
+{
+	STAILQ_CONCAT(&waiting, &pending);
+
+	for (uint32_t i = 0; i < nb_cpus; i++)
+		snapshot[i] = cpus[i].rcu_qs;
+
+	grace_period = true;
+}
+
+// Called with rcu_lock held.
+static void
+rcu_timer_arm(void)
+{
+	if (rcu_timer_armed)
+		return;
+
+	rcu_timer_armed = true;
+	timer_add(&rcu_timer, NSEC_PER_SEC / TICK_HZ);
+}
+
+static void
+rcu_process(void *arg)
+{
+	struct rcu_list done = STAILQ_HEAD_INITIALIZER(done);
+	struct rcu_head *head;
+	uint32_t flags;
+
+	(void)arg;
+
+	spin_lock_irqsave(&rcu_lock, flags);
+
+	rcu_timer_armed = false;
+
+	if (grace_period && grace_period_over(cpu_current_index()))
+	{
+		STAILQ_CONCAT(&done, &waiting);
+		grace_period = false;
+	}
+
+	if (!grace_period && !STAILQ_EMPTY(&pending))
+		grace_period_start();
+
+	if (grace_period)
+		rcu_timer_arm();
+
+	spin_unlock_irqrestore(&rcu_lock, flags);
+
+	while ((head = STAILQ_FIRST(&done)) != NULL)
+	{
+		STAILQ_REMOVE_HEAD(&done, next);
+		head->function(head->arg);
+	}
+}
+
+void
+rcu_setup(void)
+{
+	timer_init(&rcu_timer, rcu_process, NULL);
+}
+
+void
+call_rcu(struct rcu_head *head, rcu_callback_t function, void *arg)
+{
+	uint32_t flags;
+
+	head->function = function;
+	head->arg = arg;
+
+	spin_lock_irqsave(&rcu_lock, flags);
+	STAILQ_INSERT_TAIL(&pending, head, next);
+	rcu_timer_arm();
+	spin_unlock_irqrestore(&rcu_lock, flags);
+}
+
+struct rcu_sync
+{
+	struct rcu_head		head;
+	struct completion	done;
+};
+
+static void
+rcu_sync_done(void *arg)
+{
+	struct rcu_sync *sync = arg;
+
+	complete(&sync->done);
+}
+
+void
+synchronize_rcu(void)
+{
+	struct rcu_sync sync;
+
+	assert(cpu_current()->rcu_nesting == 0);
+
+	completion_init(&sync.done);
+	call_rcu(&sync.head, rcu_sync_done, &sync);
+	wait_for_completion(&sync.done);
+}
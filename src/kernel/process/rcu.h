@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Read-copy-update, for data read on every path and seldom written.
+ *
+ * Readers take no lock: they only keep interrupts off between
+ * rcu_read_lock() and rcu_read_unlock(), and may not block there. A
+ * writer publishes a new version with rcu_assign_pointer() or the _RCU
+ * list macros, and frees the old one with call_rcu() once every CPU has
+ * gone through a quiescent state: a context switch, an interrupt, a
+ * system call, or idleness. None can happen inside a read-side section,
+ * so by then no reader can still be looking at the old version.
+ *
+ * Writers must still be serialized with one another.
+ */
+
+#pragma once
+
+#include <lib/queue.h>
+#include <lib/types.h>
+#include <arch/x86/atomic.h>
+#include <arch/x86/irq.h>
+#include <arch/x86/percpu.h>
+
+typedef void (*rcu_callback_t)(void *arg);
+
+struct rcu_head
+{
+	STAILQ_ENTRY(rcu_head) next;
+	rcu_callback_t	function;
+	void		*arg;
+};
+
+static inline void
+rcu_read_lock(void)
+{
+	uint32_t flags;
+	struct cpu *cpu;
+
+	X86_IRQs_DISABLE(flags);
+
+	cpu = cpu_current();
+	if (cpu->rcu_nesting++ == 0)
+		cpu->rcu_flags = flags;
+}
+
+static inline void
+rcu_read_unlock(void)
+{
+	struct cpu *cpu = cpu_current();
+
+	if (--cpu->rcu_nesting == 0)
+		X86_IRQs_ENABLE(cpu->rcu_flags);
+}
+
+// Called wherever the CPU cannot be inside a read-side section.
+static inline void
+rcu_note_qs(void)
+{
+	cpu_current()->rcu_qs++;
+}
+
+// Load a pointer published with rcu_assign_pointer().
+#define rcu_dereference(p) \
+	({ __typeof__(p) _p = *(__typeof__(p) volatile *)&(p); barrier(); _p; })
+
+// Make value, initialized beforehand, visible to readers through p.
+#define rcu_assign_pointer(p, value) \
+	({ barrier(); *(__typeof__(p) volatile *)&(p) = (value); })
+
+#define LIST_FOREACH_RCU(var, head, field) \
+	for ((var) = rcu_dereference((head)->lh_first); \
+	     (var); \
+	     (var) = rcu_dereference((var)->field.le_next))
+
+#define LIST_INSERT_HEAD_RCU(head, elm, field) do { \
+	(elm)->field.le_next = (head)->lh_first; \
+	(elm)->field.le_prev = &(head)->lh_first; \
+	if ((head)->lh_first != NULL) \
+		(head)->lh_first->field.le_prev = &(elm)->field.le_next; \
+	rcu_assign_pointer((head)->lh_first, (elm)); \
+} while (0)
+
+// elm keeps its link to the rest of the list for the readers still on it.
+#define LIST_REMOVE_RCU(elm, field)	LIST_REMOVE(elm, field)
+
+void rcu_setup(void);
+
+/*
+ * Have function(arg) called, under the kernel lock, once the readers that
+ * may be using what was just unpublished are done.
+ */
+void call_rcu(struct rcu_head *head, rcu_callback_t function, void *arg);
+
+// Block until the current readers are done. Called under the kernel lock.
+void synchronize_rcu(void);
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Between the scheduler core (scheduler.c), which owns the per-CPU run
+ * queues, and the policy that decides in which order their threads run.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+#include <lib/queue.h>
+#include <lib/c/string.h>
+#include <lib/c/stdbool.h>
+#include <arch/x86/spinlock.h>
+
+#include "thread.h"
+#include "sched_rt.h"
+#ifdef CONFIG_SCHED_FAIR
+#include "sched_fair.h"
+#else
+#include "sched_prio.h"
+#endif
+
+struct run_queue
+{
+	ticket_lock_t	lock;
+	uint32_t	cpu;
+	TAILQ_HEAD(, thread) threads;	/* all of them, in no order */
+	volatile uint32_t nb_threads;	/* read unlocked to find the busiest */
+	volatile bool	evict;		/* some may no longer run here */
+	uint32_t	ticks;		/* tick_count() at its last tick */
+	struct rt_queue	rt;
+#ifdef CONFIG_SCHED_FAIR
+	struct fair_queue normal;	/* policy state */
+#else
+	struct prio_queue normal;
+#endif
+};
+
+static inline bool
+sched_runs_on(const thread_t *t, uint32_t cpu)
+{
+	return (t->affinity & (1u << cpu)) != 0;
+}
+
+// Whether t may be picked by cpu: it is ready, allowed and not running elsewhere.
+static inline bool
+sched_can_run(const thread_t *t, uint32_t cpu, const thread_t *current)
+{
+	return t->state == THREAD_READY && sched_runs_on(t, cpu)
+		&& (t->cpu_state != NULL || t == current);
+}
+
+/*
+ * The policy, sched_prio.c or sched_fair.c (SCHED in the Makefile), called
+ * with the run queue locked. A running thread stays queued; wakeup tells a
+ * thread that was blocked from a new or migrated one.
+ */
+void sched_normal_init(struct run_queue *rq);
+void sched_normal_enqueue(struct run_queue *rq, thread_t *t, bool wakeup);
+void sched_normal_dequeue(struct run_queue *rq, thread_t *t);
+// Best thread that sched_can_run() on the queue's CPU, or NULL.
+thread_t *sched_normal_pick(struct run_queue *rq, thread_t *current);
+// One more timer tick spent running current.
+void sched_normal_tick(struct run_queue *rq, thread_t *current);
+
+/* The real-time class (sched_rt.c), served first unless throttled. */
+void sched_rt_init(struct run_queue *rq);
+void sched_rt_enqueue(struct run_queue *rq, thread_t *t);
+void sched_rt_dequeue(struct run_queue *rq, thread_t *t);
+thread_t *sched_rt_pick(struct run_queue *rq, thread_t *current);
+// Every tick of the queue's CPU, whatever the class of current.
+void sched_rt_tick(struct run_queue *rq, thread_t *current);
@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/types.h>
+#include <lib/div64.h>
+#include <lib/c/string.h>
+#include <lib/c/assert.h>
+#include <arch/x86/percpu.h>
+#include <arch/x86/tsc.h>
+
+#include "sched_class.h"
+
+/*
+ * Each thread accumulates virtual runtime: the TSC cycles it ran, scaled
+ * by SCHED_FAIR_NICE_0_WEIGHT / weight, so that heavier threads age more
+ * slowly. The ready thread with the least of it runs next, and keeps the
+ * CPU for its share of the target latency unless a thread further behind
+ * shows up.
+ *
+ * A thread that leaves a queue carries its lag, its vruntime relative to
+ * the queue's min_vruntime, to be placed on any other queue alike. The
+ * lag is credit for half a latency at most, so that long sleepers get
+ * ahead of CPU hogs without starving them.
+ */
+
+/* Weight of each nice value, each step being worth about 10% of CPU time. */
+static const uint32_t nice_weights[THREAD_NICE_MAX - THREAD_NICE_MIN + 1] = {
+	/* -16 */ 36291, 29154, 23254, 18705, 14949, 11916,
+	/* -10 */ 9548, 7620, 6100, 4904, 3906,
+	/*  -5 */ 3121, 2501, 1991, 1586, 1277,
+	/*   0 */ 1024, 820, 655, 526, 423,
+	/*   5 */ 335, 272, 215, 172, 137,
+	/*  10 */ 110, 87, 70, 56, 45,
+	/*  15 */ 36,
+};
+
+static uint64_t
+latency_cycles(void)
+{
+	return (uint64_t)CONFIG_SCHED_LATENCY_MS * tsc_khz;
+}
+
+static uint32_t
+tree_height(const thread_t *n)
+{
+	return n ? n->fair_height : 0;
+}
+
+// Threads with the same vruntime are told apart by address.
+static bool
+before(const thread_t *a, const thread_t *b)
+{
+	return a->vruntime < b->vruntime
+		|| (a->vruntime == b->vruntime && (vaddr_t)a < (vaddr_t)b);
+}
+
+static void
+update_height(thread_t *n)
+{
+	uint32_t left = tree_height(n->fair_left);
+	uint32_t right = tree_height(n->fair_right);
+
+	n->fair_height = 1 + (left > right ? left : right);
+}
+
+static thread_t *
+rotate_right(thread_t *n)
+{
+	thread_t *left = n->fair_left;
+
+	n->fair_left = left->fair_right;
+	left->fair_right = n;
+	update_height(n);
+	update_height(left);
+
+	return left;
+}
+
+static thread_t *
+rotate_left(thread_t *n)
+{
+	thread_t *right = n->fair_right;
+
+	n->fair_right = right->fair_left;
+	right->fair_left = n;
+	update_height(n);
+	update_height(right);
+
+	return right;
+}
+
+static thread_t *
+rebalance(thread_t *n)
+{
+	update_height(n);
+
+	if (tree_height(n->fair_left) > tree_height(n->fair_right) + 1)
+	{
+		if (tree_height(n->fair_left->fair_left)
+		    < tree_height(n->fair_left->fair_right))
+			n->fair_left = rotate_left(n->fair_left);
+		return rotate_right(n);
+	}
+
+	if (tree_height(n->fair_right) > tree_height(n->fair_left) + 1)
+	{
+		if (tree_height(n->fair_right->fair_right)
+		    < tree_height(n->fair_right->fair_left))
+			n->fair_right = rotate_right(n->fair_right);
+		return rotate_left(n);
+	}
+
+	return n;
+}
+
+static thread_t *
+tree_insert(thread_t *root, thread_t *t)
+{
+	if (!root)
+	{
+		t->fair_left = t->fair_right = NULL;
+		t->fair_height = 1;
+		return t;
+	}
+
+	if (before(t, root))
+		root->fair_left = tree_insert(root->fair_left, t);
+	else
+		root->fair_right = tree_insert(root->fair_right, t);
+
+	return rebalance(root);
+}
+
+static thread_t *
+tree_remove_first(thread_t *root, thread_t **first)
+{
+	if (!root->fair_left)
+	{
+		*first = root;
+		return root->fair_right;
+	}
+
+	root->fair_left = tree_remove_first(root->fair_left, first);
+
+	return rebalance(root);
+}
+
+static thread_t *
+tree_remove(thread_t *root, thread_t *t)
+{
+	thread_t *successor;
+
+	assert(root != NULL);
+
+	if (root != t)
+	{
+		if (before(t, root))
+			root->fair_left = tree_remove(root->fair_left, t);
+		else
+			root->fair_right = tree_remove(root->fair_right, t);
+
+		return rebalance(root);
+	}
+
+	t->fair_height = 0;
+
+	if (!t->fair_left)
+		return t->fair_right;
+	if (!t->fair_right)
+		return t->fair_left;
+
+	t->fair_right = tree_remove_first(t->fair_right, &successor);
+	successor->fair_left = t->fair_left;
+	successor->fair_right = t->fair_right;
+
+	return rebalance(successor);
+}
+
+// Leftmost thread that the CPU may run; the leftmost one, mostly.
+static thread_t *
+first_runnable(thread_t *n, uint32_t cpu, const thread_t *current)
+{
+	thread_t *t;
+
+	if (!n)
+		return NULL;
+
+	if ((t = first_runnable(n->fair_left, cpu, current)) != NULL)
+		return t;
+
+	if (sched_can_run(n, cpu, current))
+		return n;
+
+	return first_runnable(n->fair_right, cpu, current);
+}
+
+static void
+update_min_vruntime(struct fair_queue *q)
+{
+	thread_t *first = q->root;
+
+	if (!first)
+		return;
+
+	while (first->fair_left)
+		first = first->fair_left;
+
+	if (first->vruntime > q->min_vruntime)
+		q->min_vruntime = first->vruntime;
+}
+
+// Charge t, which is running, for the time since it was last charged.
+static void
+update_current(struct fair_queue *q, thread_t *t, uint64_t now)
+{
+	uint64_t delta = now - t->exec_start;
+
+	t->exec_start = now;
+
+	// Nobody runs that long between two ticks; this avoids 64-bit divides
+	if (delta > 0xFFFFFFFF)
+		delta = 0xFFFFFFFF;
+
+	q->root = tree_remove(q->root, t);
+	t->vruntime += (delta * ((SCHED_FAIR_NICE_0_WEIGHT << 16) / t->weight))
+		>> 16;
+	q->root = tree_insert(q->root, t);
+
+	update_min_vruntime(q);
+}
+
+// Share of the latency that t gets among the threads of the queue.
+static uint64_t
+time_slice(const struct fair_queue *q, const thread_t *t)
+{
+	uint64_t slice = div64_u32(latency_cycles(), q->total_weight, NULL)
+		* t->weight;
+	uint64_t minimum = latency_cycles() / 8;
+
+	return slice > minimum ? slice : minimum;
+}
+
+static bool
+queued_on(const thread_t *t, const struct run_queue *rq)
+{
+	return t->fair_height != 0 && t->cpu == rq->cpu;
+}
+
+void
+sched_normal_init(struct run_queue *rq)
+{
+	memset(&rq->normal, 0, sizeof(rq->normal));
+}
+
+void
+sched_normal_enqueue(struct run_queue *rq, thread_t *t, bool wakeup)
+{
+	struct fair_queue *q = &rq->normal;
+	uint64_t now = rdtsc();
+
+	(void)wakeup;
+
+	if (t->vlag < 0 && (uint64_t)-t->vlag > q->min_vruntime)
+		t->vruntime = 0;
+	else
+		t->vruntime = q->min_vruntime + (uint64_t)t->vlag;
+
+	t->weight = nice_weights[t->nice - THREAD_NICE_MIN];
+	t->exec_start = now;
+	t->slice_start = now;
+
+	q->root = tree_insert(q->root, t);
+	q->total_weight += t->weight;
+
+	update_min_vruntime(q);
+}
+
+void
+sched_normal_dequeue(struct run_queue *rq, thread_t *t)
+{
+	struct fair_queue *q = &rq->normal;
+
+	// It blocks: charge what it ran since the last tick
+	if (t == cpu_current()->current_thread)
+		update_current(q, t, rdtsc());
+
+	q->root = tree_remove(q->root, t);
+	q->total_weight -= t->weight;
+
+	// Before min_vruntime moves past t, had it been the leftmost
+	t->vlag = (int64_t)(t->vruntime - q->min_vruntime);
+
+	if (t->vlag < -(int64_t)(latency_cycles() / 2))
+		t->vlag = -(int64_t)(latency_cycles() / 2);
+
+	update_min_vruntime(q);
+}
+
+thread_t *
+sched_normal_pick(struct run_queue *rq, thread_t *current)
+{
+	struct fair_queue *q = &rq->normal;
+	uint64_t now = rdtsc();
+	bool current_here = queued_on(current, rq)
+		&& sched_can_run(current, rq->cpu, current);
+	thread_t *next;
+
+	if (current_here)
+		update_current(q, current, now);
+
+	next = first_runnable(q->root, rq->cpu, current);
+
+	if (current_here && next != current)
+	{
+		bool slice_left = now - current->slice_start
+			< time_slice(q, current);
+
+		// Switching costs: only for a thread far enough behind
+		if (slice_left && next->vruntime + latency_cycles() / 8
+		    >= current->vruntime)
+			return current;
+	}
+
+	if (next && (next != current || now - current->slice_start
+		     >= time_slice(q, current)))
+	{
+		next->exec_start = now;
+		next->slice_start = now;
+	}
+
+	return next;
+}
+
+void
+sched_normal_tick(struct run_queue *rq, thread_t *current)
+{
+	update_current(&rq->normal, current, rdtsc());
+}
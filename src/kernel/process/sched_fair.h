@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Fair-share policy: the thread that has had the least weighted CPU time
+ * runs next.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+
+/* Period in which every ready thread of a queue should get to run once. */
+#ifndef CONFIG_SCHED_LATENCY_MS
+#define CONFIG_SCHED_LATENCY_MS	20
+#endif
+
+#define SCHED_FAIR_NICE_0_WEIGHT	1024
+
+struct thread;
+
+struct fair_queue
+{
+	struct thread	*root;		/* AVL tree ordered by vruntime */
+	uint64_t	min_vruntime;	/* never goes back */
+	uint32_t	total_weight;
+};
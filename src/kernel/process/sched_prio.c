@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/types.h>
+#include <lib/c/string.h>
+#include <lib/c/assert.h>
+
+#include "sched_class.h"
+
+/*
+ * A thread starts at the static priority of its nice value. Each time it
+ * wakes up from a block (keyboard, wait, semaphore...) it earns a bonus
+ * level, and each time it uses up a whole time slice it loses one, so that
+ * interactive threads drift above CPU hogs of the same nice value.
+ */
+
+static inline uint32_t
+bsf(uint32_t word)
+{
+	uint32_t bit;
+
+	asm("bsf %1, %0" : "=r"(bit) : "rm"(word));
+	return bit;
+}
+
+static uint32_t
+static_prio(const thread_t *t)
+{
+	return (uint32_t)(SCHED_PRIO_NICE_0 + t->nice);
+}
+
+static uint32_t
+effective_prio(const thread_t *t)
+{
+	int prio = (int)static_prio(t) - t->bonus;
+
+	if (prio < 0)
+		return 0;
+	if (prio >= SCHED_PRIO_LEVELS)
+		return SCHED_PRIO_LEVELS - 1;
+
+	return (uint32_t)prio;
+}
+
+// From 8 ticks at the highest static priority down to 1 at the lowest.
+static uint32_t
+time_slice(const thread_t *t)
+{
+	return 1 + (SCHED_PRIO_LEVELS - 1 - static_prio(t)) / 4;
+}
+
+static void
+array_init(struct prio_array *array)
+{
+	array->bitmap = 0;
+
+	for (uint32_t p = 0; p < SCHED_PRIO_LEVELS; p++)
+		TAILQ_INIT(&array->levels[p]);
+}
+
+static void
+array_add(struct prio_array *array, thread_t *t)
+{
+	TAILQ_INSERT_TAIL(&array->levels[t->prio], t, prio_next);
+	array->bitmap |= 1u << t->prio;
+	t->prio_array = array;
+}
+
+static void
+array_remove(thread_t *t)
+{
+	struct prio_array *array = t->prio_array;
+
+	TAILQ_REMOVE(&array->levels[t->prio], t, prio_next);
+	if (TAILQ_EMPTY(&array->levels[t->prio]))
+		array->bitmap &= ~(1u << t->prio);
+	t->prio_array = NULL;
+}
+
+void
+sched_normal_init(struct run_queue *rq)
+{
+	struct prio_queue *q = &rq->normal;
+
+	array_init(&q->arrays[0]);
+	array_init(&q->arrays[1]);
+	q->active = &q->arrays[0];
+	q->expired = &q->arrays[1];
+}
+
+void
+sched_normal_enqueue(struct run_queue *rq, thread_t *t, bool wakeup)
+{
+	if (wakeup && t->bonus < SCHED_BONUS_MAX)
+		t->bonus++;
+
+	if (t->slice == 0)
+		t->slice = time_slice(t);
+
+	t->prio = effective_prio(t);
+	array_add(rq->normal.active, t);
+}
+
+void
+sched_normal_dequeue(struct run_queue *rq, thread_t *t)
+{
+	(void)rq;
+
+	array_remove(t);
+}
+
+thread_t *
+sched_normal_pick(struct run_queue *rq, thread_t *current)
+{
+	struct prio_queue *q = &rq->normal;
+	thread_t *t;
+
+	// Everybody has had their turn: start a new round
+	if (q->active->bitmap == 0 && q->expired->bitmap != 0)
+	{
+		struct prio_array *array = q->active;
+
+		q->active = q->expired;
+		q->expired = array;
+	}
+
+	/*
+	 * Usually the head of the first level is the answer. Threads still
+	 * running elsewhere or waiting to move to another CPU are skipped.
+	 */
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		struct prio_array *array = i == 0 ? q->active : q->expired;
+
+		for (uint32_t bits = array->bitmap; bits != 0; bits &= bits - 1)
+		{
+			TAILQ_FOREACH(t, &array->levels[bsf(bits)], prio_next)
+			{
+				if (sched_can_run(t, rq->cpu, current))
+					return t;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+void
+sched_normal_tick(struct run_queue *rq, thread_t *current)
+{
+	assert(current->prio_array != NULL);
+
+	if (--current->slice > 0)
+		return;
+
+	if (current->bonus > -SCHED_BONUS_MAX)
+		current->bonus--;
+
+	array_remove(current);
+	current->slice = time_slice(current);
+	current->prio = effective_prio(current);
+	array_add(rq->normal.expired, current);
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * O(1) priority policy: one queue per priority level, found with a bitmap.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+#include <lib/queue.h>
+
+#define SCHED_PRIO_LEVELS	32
+#define SCHED_PRIO_NICE_0	16	/* static priority of nice 0 */
+
+/* Dynamic priority moves at most this many levels around the static one. */
+#define SCHED_BONUS_MAX		4
+
+struct thread;
+
+struct prio_array
+{
+	uint32_t	bitmap;		/* bit p set: levels[p] is not empty */
+	TAILQ_HEAD(, thread) levels[SCHED_PRIO_LEVELS];
+};
+
+/*
+ * Threads run from the active array until their time slice is used up,
+ * then wait in the expired array until every thread of the active one has
+ * had its turn, so that low priorities are not starved.
+ */
+struct prio_queue
+{
+	struct prio_array arrays[2];
+	struct prio_array *active;
+	struct prio_array *expired;
+};
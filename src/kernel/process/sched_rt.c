@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/types.h>
+#include <lib/c/string.h>
+#include <lib/c/assert.h>
+
+#include "sched_class.h"
+
+/*
+ * The ready thread of highest priority runs. A SCHED_FIFO thread keeps the
+ * CPU until it blocks or a more urgent one wakes up; a SCHED_RR thread
+ * also goes to the back of its level every SCHED_RT_SLICE ticks.
+ */
+
+static inline uint32_t
+bsr(uint32_t word)
+{
+	uint32_t bit;
+
+	asm("bsr %1, %0" : "=r"(bit) : "rm"(word));
+	return bit;
+}
+
+void
+sched_rt_init(struct run_queue *rq)
+{
+	struct rt_queue *q = &rq->rt;
+
+	q->bitmap = 0;
+	for (uint32_t p = 0; p < SCHED_RT_LEVELS; p++)
+		TAILQ_INIT(&q->levels[p]);
+
+	q->period_ticks = 0;
+	q->runtime = 0;
+	q->throttled = false;
+}
+
+void
+sched_rt_enqueue(struct run_queue *rq, thread_t *t)
+{
+	struct rt_queue *q = &rq->rt;
+
+	assert(t->rt_priority < SCHED_RT_LEVELS);
+
+	if (t->rt_slice == 0)
+		t->rt_slice = SCHED_RT_SLICE;
+
+	TAILQ_INSERT_TAIL(&q->levels[t->rt_priority], t, rt_next);
+	q->bitmap |= 1u << t->rt_priority;
+	t->rt_queued = true;
+}
+
+void
+sched_rt_dequeue(struct run_queue *rq, thread_t *t)
+{
+	struct rt_queue *q = &rq->rt;
+
+	TAILQ_REMOVE(&q->levels[t->rt_priority], t, rt_next);
+	if (TAILQ_EMPTY(&q->levels[t->rt_priority]))
+		q->bitmap &= ~(1u << t->rt_priority);
+	t->rt_queued = false;
+}
+
+thread_t *
+sched_rt_pick(struct run_queue *rq, thread_t *current)
+{
+	struct rt_queue *q = &rq->rt;
+	thread_t *t;
+
+	for (uint32_t bits = q->bitmap; bits != 0; )
+	{
+		uint32_t p = bsr(bits);
+
+		TAILQ_FOREACH(t, &q->levels[p], rt_next)
+		{
+			if (sched_can_run(t, rq->cpu, current))
+				return t;
+		}
+
+		bits &= ~(1u << p);
+	}
+
+	return NULL;
+}
+
+void
+sched_rt_tick(struct run_queue *rq, thread_t *current)
+{
+	struct rt_queue *q = &rq->rt;
+
+	if (current->rt_queued && current->cpu == rq->cpu
+	    && current->state == THREAD_RUNNING)
+	{
+		if (++q->runtime >= SCHED_RT_RUNTIME)
+			q->throttled = true;
+
+		if (current->policy == SCHED_RR && --current->rt_slice == 0)
+		{
+			current->rt_slice = SCHED_RT_SLICE;
+			TAILQ_REMOVE(&q->levels[current->rt_priority], current,
+				     rt_next);
+			TAILQ_INSERT_TAIL(&q->levels[current->rt_priority],
+					  current, rt_next);
+		}
+	}
+
+	if (++q->period_ticks >= SCHED_RT_PERIOD)
+	{
+		q->period_ticks = 0;
+		q->runtime = 0;
+		q->throttled = false;
+	}
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Real-time class: fixed priorities, served before the normal policy.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+#include <lib/queue.h>
+#include <lib/c/stdbool.h>
+
+#define SCHED_RT_LEVELS		32	/* priority p uses levels[p] */
+#define SCHED_RT_SLICE		10	/* ticks of a SCHED_RR turn */
+
+/*
+ * Real-time threads may use SCHED_RT_RUNTIME ticks of each period of
+ * SCHED_RT_PERIOD ticks on a CPU; the rest is left to normal threads.
+ */
+#define SCHED_RT_PERIOD		100
+#define SCHED_RT_RUNTIME	95
+
+struct thread;
+
+struct rt_queue
+{
+	uint32_t	bitmap;		/* bit p set: levels[p] is not empty */
+	TAILQ_HEAD(, thread) levels[SCHED_RT_LEVELS];
+	uint32_t	period_ticks;	/* elapsed in the current period */
+	uint32_t	runtime;	/* ticks used by real-time threads in it */
+	bool		throttled;	/* used up */
+};
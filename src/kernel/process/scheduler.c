@@ -0,0 +1,728 @@
+/*
+ * Copyright (c) 2017 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/types.h>
+#include <lib/status.h>
+#include <lib/c/string.h>
+#include <lib/c/assert.h>
+#include <lib/c/stdbool.h>
+#include <arch/x86/paging.h>
+#include <arch/x86/gdt.h>
+#include <arch/x86/percpu.h>
+#include <arch/x86/spinlock.h>
+#include <arch/x86/lapic.h>
+#include <arch/x86/smp.h>
+#include <arch/x86/tick.h>
+#include <arch/x86/kernel_lock.h>
+
+#include "scheduler.h"
+#include "sched_class.h"
+#include "process.h"
+#include "timer.h"
+#include "rcu.h"
+
+
+/*
+ * Each CPU has its own queue and only runs threads queued there; a thread
+ * stays queued while it runs. From the moment a CPU picks a thread until
+ * cpu_context_switch() has saved it again, its cpu_state is NULL and no
+ * other CPU may take it. Idle threads belong to their CPU and are never
+ * queued.
+ *
+ * Threads are queued on the CPU that creates or wakes them, unless their
+ * affinity mask rules it out. A CPU that runs out of threads steals one
+ * from the busiest queue, and a CPU that queues work while busy kicks an
+ * idle one with a reschedule IPI. Every BALANCE_INTERVAL ticks each CPU
+ * also pulls a thread over from a queue longer than its own by two or
+ * more, so that CPU-bound threads spread out even when no CPU is idle.
+ *
+ * Which of the threads of a queue runs next is left to the policy (see
+ * sched_class.h), except for real-time threads, which come first. A
+ * real-time thread that wakes up preempts a less urgent one at once: the
+ * CPU is sent a reschedule IPI, or itself reschedules on its way out of
+ * the system call or interrupt handler.
+ *
+ * The periodic tick only serves to share a CPU: it stops while the queue
+ * holds a single thread or none, and starts again as soon as a second
+ * thread is queued. Meanwhile single ticks still come for the timers of
+ * the CPU (see timer.c) and, if a thread runs, for the next balancing.
+ */
+
+#define BALANCE_INTERVAL	20
+
+static struct run_queue run_queues[NB_CPUS];
+
+void
+scheduler_setup(void)
+{
+	for (uint32_t cpu = 0; cpu < NB_CPUS; cpu++)
+	{
+		struct run_queue *rq = &run_queues[cpu];
+
+		ticket_lock_init(&rq->lock);
+		rq->cpu = cpu;
+		TAILQ_INIT(&rq->threads);
+		rq->nb_threads = 0;
+		rq->evict = false;
+		sched_rt_init(rq);
+		sched_normal_init(rq);
+	}
+}
+
+// Self if t may run here, else the least loaded online CPU it may run on.
+static uint32_t
+allowed_cpu(const thread_t *t, uint32_t self)
+{
+	uint32_t best = self;
+
+	if (sched_runs_on(t, self))
+		return self;
+
+	for (uint32_t i = 0; i < nb_cpus; i++)
+	{
+		if (cpus[i].online && sched_runs_on(t, i)
+		    && (best == self
+			|| run_queues[i].nb_threads < run_queues[best].nb_threads))
+			best = i;
+	}
+
+	return best;
+}
+
+static void
+run_queue_add(struct run_queue *rq, thread_t *t, bool wakeup)
+{
+	t->cpu = rq->cpu;
+	t->queued = true;
+	TAILQ_INSERT_TAIL(&rq->threads, t, sched_next);
+	rq->nb_threads++;
+
+	if (t->policy == SCHED_NORMAL)
+		sched_normal_enqueue(rq, t, wakeup);
+	else
+		sched_rt_enqueue(rq, t);
+}
+
+static void
+run_queue_remove(struct run_queue *rq, thread_t *t)
+{
+	if (t->rt_queued)
+		sched_rt_dequeue(rq, t);
+	else
+		sched_normal_dequeue(rq, t);
+
+	TAILQ_REMOVE(&rq->threads, t, sched_next);
+	rq->nb_threads--;
+	t->queued = false;
+}
+
+// Always in index order, so that two CPUs locking them all cannot deadlock.
+static void
+lock_all_queues(void)
+{
+	for (uint32_t i = 0; i < nb_cpus; i++)
+		ticket_lock(&run_queues[i].lock);
+}
+
+static void
+unlock_all_queues(void)
+{
+	for (uint32_t i = nb_cpus; i-- > 0; )
+		ticket_unlock(&run_queues[i].lock);
+}
+
+// Whether t is more urgent than running, which runs on some CPU.
+static bool
+preempts(const thread_t *t, const thread_t *running)
+{
+	return t->policy != SCHED_NORMAL
+		&& (running->policy == SCHED_NORMAL
+		    || t->rt_priority > running->rt_priority);
+}
+
+// Have cpu call schedule() as soon as possible.
+static void
+resched_cpu(uint32_t cpu)
+{
+	if (cpu == cpu_current_index())
+		cpus[cpu].need_resched = true;
+	else
+		LocalApicSendIpi(cpus[cpu].apic_id, RESCHEDULE_INTERRUPT);
+}
+
+// Wake up an idle CPU allowed by mask, if any, to steal work from this one.
+static void
+kick_idle_cpu(uint32_t self, uint32_t mask)
+{
+	for (uint32_t i = 0; i < nb_cpus; i++)
+	{
+		if (i != self && cpus[i].online && (mask & (1u << i))
+		    && cpus[i].current_thread == cpus[i].idle_thread)
+		{
+			LocalApicSendIpi(cpus[i].apic_id, RESCHEDULE_INTERRUPT);
+			return;
+		}
+	}
+}
+
+/*
+ * The first CPU, starting with self, where real-time thread t may run and
+ * would run at once, else where allowed_cpu() puts it.
+ */
+static uint32_t
+rt_cpu(const thread_t *t, uint32_t self)
+{
+	for (uint32_t i = 0; i < nb_cpus; i++)
+	{
+		uint32_t cpu = (self + i) % nb_cpus;
+		thread_t *running = cpus[cpu].current_thread;
+
+		if (cpus[cpu].online && running && sched_runs_on(t, cpu)
+		    && (running == cpus[cpu].idle_thread
+			|| preempts(t, running)))
+			return cpu;
+	}
+
+	return allowed_cpu(t, self);
+}
+
+void
+scheduler_insert_thread(thread_t *t)
+{
+	uint32_t self = cpu_current_index();
+	uint32_t target = t->policy == SCHED_NORMAL ? allowed_cpu(t, self)
+		: rt_cpu(t, self);
+	struct run_queue *rq = &run_queues[target];
+	uint32_t flags;
+
+	ticket_lock_irqsave(&rq->lock, flags);
+
+	/* Don't do anything for already ready threads */
+	if (t->state == THREAD_READY)
+	{
+		ticket_unlock_irqrestore(&rq->lock, flags);
+		return;
+	}
+
+	/* New (zeroed), running, or blocked — never ready/zombie. */
+	assert(t->state != THREAD_ZOMBIE);
+
+	bool wakeup = t->state == THREAD_BLOCKED;
+
+	t->state = THREAD_READY;
+	run_queue_add(rq, t, wakeup);
+
+	ticket_unlock(&rq->lock);
+
+	if (target != self)
+	{
+		LocalApicSendIpi(cpus[target].apic_id, RESCHEDULE_INTERRUPT);
+	}
+	else if (cpus[self].current_thread == cpus[self].idle_thread)
+	{
+		// Its tick is stopped: don't wait for it
+		cpus[self].need_resched = true;
+	}
+	else
+	{
+		if (preempts(t, cpus[self].current_thread))
+			cpus[self].need_resched = true;
+
+		// Two threads to share the CPU
+		tick_start();
+
+		kick_idle_cpu(self, t->affinity);
+	}
+
+	X86_IRQs_ENABLE(flags);
+}
+
+void
+scheduler_remove_thread(thread_t *t)
+{
+	struct run_queue *rq = &run_queues[t->cpu];
+	uint32_t flags;
+
+	ticket_lock_irqsave(&rq->lock, flags);
+	run_queue_remove(rq, t);
+	ticket_unlock_irqrestore(&rq->lock, flags);
+}
+
+// Called with the local queue locked, which it releases.
+static void
+switch_to(struct run_queue *rq, thread_t *next_thread,
+		struct cpu_state **save_to)
+{
+	struct cpu_state *next_state = next_thread->cpu_state;
+	uint32_t next_pd = (next_thread->process
+			&& next_thread->process->page_directory)
+		? next_thread->process->page_directory
+		: page_directory_kernel();
+
+	next_thread->cpu_state = NULL;
+	cpu_current()->page_directory = next_pd;
+
+	page_directory_switch(next_pd);
+
+	if (next_thread->process)
+		set_kernel_stack(next_thread->kernel_stack_top);
+
+	ticket_unlock(&rq->lock);
+
+	cpu_context_switch(save_to, next_state);
+}
+
+// A ready thread whose context is saved, taken off the busiest other queue.
+static thread_t *
+steal_thread(uint32_t self)
+{
+	struct run_queue *victim = NULL;
+	uint32_t busiest = 1;	/* a lone thread is its own CPU's business */
+	thread_t *t;
+
+	for (uint32_t i = 0; i < nb_cpus; i++)
+	{
+		if (i != self && run_queues[i].nb_threads > busiest)
+		{
+			victim = &run_queues[i];
+			busiest = victim->nb_threads;
+		}
+	}
+
+	if (!victim)
+		return NULL;
+
+	ticket_lock(&victim->lock);
+
+	TAILQ_FOREACH(t, &victim->threads, sched_next)
+	{
+		if (sched_can_run(t, self, NULL))
+		{
+			run_queue_remove(victim, t);
+			break;
+		}
+	}
+
+	ticket_unlock(&victim->lock);
+
+	return t;
+}
+
+/*
+ * Hand the threads of the local queue that may no longer run here over to
+ * a CPU they may run on. Called, and returns, with the local queue locked.
+ */
+static void
+evict_threads(struct run_queue *rq, uint32_t self, thread_t *current)
+{
+	TAILQ_HEAD(, thread) evicted = TAILQ_HEAD_INITIALIZER(evicted);
+	thread_t *t, *next;
+
+	rq->evict = false;
+
+	for (t = TAILQ_FIRST(&rq->threads); t != NULL; t = next)
+	{
+		next = TAILQ_NEXT(t, sched_next);
+
+		if (sched_runs_on(t, self) || allowed_cpu(t, self) == self)
+			continue;
+
+		/*
+		 * current goes too: the new CPU waits for the switch to save
+		 * its context, like a thief does.
+		 */
+		if (t->state == THREAD_READY
+		    && (t->cpu_state != NULL || t == current))
+		{
+			run_queue_remove(rq, t);
+			TAILQ_INSERT_TAIL(&evicted, t, sched_next);
+		}
+		else
+		{
+			// Still running elsewhere, try again next time
+			rq->evict = true;
+		}
+	}
+
+	if (TAILQ_EMPTY(&evicted))
+		return;
+
+	ticket_unlock(&rq->lock);
+
+	while ((t = TAILQ_FIRST(&evicted)) != NULL)
+	{
+		uint32_t target = allowed_cpu(t, self);
+
+		TAILQ_REMOVE(&evicted, t, sched_next);
+
+		ticket_lock(&run_queues[target].lock);
+		run_queue_add(&run_queues[target], t, false);
+		ticket_unlock(&run_queues[target].lock);
+
+		LocalApicSendIpi(cpus[target].apic_id, RESCHEDULE_INTERRUPT);
+	}
+
+	ticket_lock(&rq->lock);
+}
+
+/*
+ * Keep the tick only if another thread waits for the CPU, or may soon: one
+ * queued here but not yet switched out elsewhere. Otherwise it comes back
+ * for the next timer, and for the next balancing if a thread runs.
+ */
+static void
+update_tick(struct run_queue *rq, thread_t *next)
+{
+	bool idle = next == cpus[rq->cpu].idle_thread;
+	uint32_t timer = timer_next_tick();
+
+	if (rq->nb_threads == 0)
+	{
+		tick_stop(timer);
+	}
+	else if (rq->nb_threads == 1 && !idle)
+	{
+		uint32_t balancing = BALANCE_INTERVAL
+			- tick_count() % BALANCE_INTERVAL;
+
+		tick_stop(timer != 0 && timer < balancing ? timer : balancing);
+	}
+	else
+	{
+		tick_start();
+	}
+}
+
+/*
+ * The most urgent real-time thread of the local queue, else the thread the
+ * policy prefers, current included, else one stolen from another queue,
+ * else this CPU's idle thread. Called, and returns, with the local queue
+ * locked.
+ */
+static thread_t *
+pick_next(struct run_queue *rq, thread_t *current)
+{
+	uint32_t self = cpu_current_index();
+	thread_t *next;
+
+	cpus[self].need_resched = false;
+
+	// A context switch: no read-side section goes across it
+	assert(cpus[self].rcu_nesting == 0);
+	rcu_note_qs();
+
+	if (rq->evict)
+		evict_threads(rq, self, current);
+
+	// Throttled real-time threads only get what nobody else wants
+	bool throttled = rq->rt.throttled;
+
+	next = throttled ? NULL : sched_rt_pick(rq, current);
+	if (!next)
+		next = sched_normal_pick(rq, current);
+	if (!next && throttled)
+		next = sched_rt_pick(rq, current);
+
+	if (!next)
+	{
+		/*
+		 * Whatever other CPUs queue here meanwhile comes with a
+		 * reschedule IPI, taken as soon as the idle thread runs.
+		 */
+		ticket_unlock(&rq->lock);
+		next = steal_thread(self);
+		ticket_lock(&rq->lock);
+
+		if (next)
+			run_queue_add(rq, next, false);
+		else
+			next = cpu_current()->idle_thread;
+	}
+
+	update_tick(rq, next);
+	thread_set_current(next);
+
+	return next;
+}
+
+/*
+ * Pull the thread with the most recent run time over from the longest
+ * queue, when it is at least two threads longer than the local one.
+ * Interrupts must be off.
+ */
+static void
+balance(uint32_t self)
+{
+	struct run_queue *rq = &run_queues[self];
+	struct run_queue *busiest = NULL;
+	uint32_t longest = rq->nb_threads + 1;
+	thread_t *t, *moved = NULL;
+
+	// Run time counts less and less as it gets older
+	ticket_lock(&rq->lock);
+	TAILQ_FOREACH(t, &rq->threads, sched_next)
+		t->recent_ticks /= 2;
+	ticket_unlock(&rq->lock);
+
+	for (uint32_t i = 0; i < nb_cpus; i++)
+	{
+		if (i != self && cpus[i].online
+		    && run_queues[i].nb_threads > longest)
+		{
+			busiest = &run_queues[i];
+			longest = busiest->nb_threads;
+		}
+	}
+
+	if (!busiest)
+		return;
+
+	ticket_lock(&busiest->lock);
+
+	TAILQ_FOREACH(t, &busiest->threads, sched_next)
+	{
+		if (sched_can_run(t, self, NULL)
+		    && (!moved || t->recent_ticks > moved->recent_ticks))
+			moved = t;
+	}
+
+	if (moved)
+		run_queue_remove(busiest, moved);
+
+	ticket_unlock(&busiest->lock);
+
+	if (moved)
+	{
+		ticket_lock(&rq->lock);
+		run_queue_add(rq, moved, false);
+		ticket_unlock(&rq->lock);
+	}
+}
+
+void
+scheduler_tick(void)
+{
+	uint32_t self = cpu_current_index();
+	struct run_queue *rq = &run_queues[self];
+	thread_t *current = thread_get_current();
+
+	ticket_lock(&rq->lock);
+
+	if (current != cpus[self].idle_thread)
+	{
+		current->recent_ticks++;
+
+		if (current->state == THREAD_RUNNING && current->cpu == self
+		    && !current->rt_queued)
+			sched_normal_tick(rq, current);
+	}
+
+	sched_rt_tick(rq, current);
+
+	ticket_unlock(&rq->lock);
+
+	// Also after some ticks were skipped, with the tick stopped
+	uint32_t now = tick_count();
+	bool balance_due = now / BALANCE_INTERVAL != rq->ticks / BALANCE_INTERVAL;
+
+	rq->ticks = now;
+
+	if (balance_due)
+		balance(self);
+
+	schedule();
+}
+
+status_t
+scheduler_set_affinity(thread_t *t, uint32_t mask)
+{
+	uint32_t online = 0;
+	uint32_t cpu;
+
+	for (uint32_t i = 0; i < nb_cpus; i++)
+	{
+		if (cpus[i].online)
+			online |= 1u << i;
+	}
+
+	if (!(mask & online))
+		return -KERNEL_INVALID_VALUE;
+
+	t->affinity = mask;
+
+	/*
+	 * A queued thread is moved by its CPU at the next schedule(); blocked
+	 * ones are queued on an allowed CPU when they wake up. A thief may
+	 * have it in hand with the old mask, so every queue takes a look.
+	 */
+	for (uint32_t i = 0; i < nb_cpus; i++)
+		run_queues[i].evict = true;
+
+	cpu = t->cpu;
+	if ((t->state == THREAD_READY || t->state == THREAD_RUNNING)
+	    && !sched_runs_on(t, cpu))
+	{
+		if (cpu == cpu_current_index())
+			schedule();
+		else
+			LocalApicSendIpi(cpus[cpu].apic_id,
+					 RESCHEDULE_INTERRUPT);
+	}
+
+	return KERNEL_OK;
+}
+
+bool
+scheduler_policy_valid(uint32_t policy, uint32_t priority)
+{
+	if (policy == SCHED_NORMAL)
+		return priority == 0;
+
+	return (policy == SCHED_FIFO || policy == SCHED_RR)
+		&& priority >= SCHED_RT_PRIO_MIN && priority <= SCHED_RT_PRIO_MAX;
+}
+
+status_t
+scheduler_set_policy(thread_t *t, uint32_t policy, uint32_t priority)
+{
+	uint32_t flags;
+
+	if (!scheduler_policy_valid(policy, priority))
+		return -KERNEL_INVALID_VALUE;
+
+	/*
+	 * With every queue locked, a queued thread stays where it is and one
+	 * in the hands of a thief picks up the new policy when it lands.
+	 */
+	X86_IRQs_DISABLE(flags);
+	lock_all_queues();
+
+	if (t->queued)
+	{
+		struct run_queue *rq = &run_queues[t->cpu];
+
+		run_queue_remove(rq, t);
+		t->policy = policy;
+		t->rt_priority = priority;
+		run_queue_add(rq, t, false);
+	}
+	else
+	{
+		t->policy = policy;
+		t->rt_priority = priority;
+	}
+
+	unlock_all_queues();
+
+	if (t->queued)
+		resched_cpu(t->cpu);
+
+	X86_IRQs_ENABLE(flags);
+
+	return KERNEL_OK;
+}
+
+status_t
+scheduler_set_nice(thread_t *t, int nice)
+{
+	if (nice < THREAD_NICE_MIN || nice > THREAD_NICE_MAX)
+		return -KERNEL_INVALID_VALUE;
+
+	// Read when it is next queued or its time slice runs out
+	t->nice = nice;
+
+	return KERNEL_OK;
+}
+
+void
+scheduler_start(void)
+{
+	static struct cpu_state *discard;
+	struct run_queue *rq = &run_queues[cpu_current_index()];
+	thread_t *boot_thread = thread_get_current();	/* this CPU's idle */
+
+	ticket_lock(&rq->lock);
+
+	boot_thread->state = THREAD_READY;
+	thread_t *next_thread = pick_next(rq, boot_thread);
+
+	/* Discard the boot stack. Never returns. */
+	switch_to(rq, next_thread, &discard);
+
+	for (;;)
+		;
+}
+
+void
+schedule(void)
+{
+	thread_t *current_thread = thread_get_current();
+	uint32_t lock_depth = kernel_lock_drop();
+	struct run_queue *rq = &run_queues[cpu_current_index()];
+
+	ticket_lock(&rq->lock);
+
+	/* Preserve THREAD_BLOCKED (wait/sem); only demote a running thread. */
+	if (current_thread->state == THREAD_RUNNING)
+		current_thread->state = THREAD_READY;
+
+	thread_t *next_thread = pick_next(rq, current_thread);
+
+	// Avoid context switch if the context does not change
+	if (current_thread != next_thread)
+	{
+		switch_to(rq, next_thread, &current_thread->cpu_state);
+
+		assert(current_thread == thread_get_current());
+		assert(current_thread->state == THREAD_RUNNING);
+	}
+	else
+	{
+		ticket_unlock(&rq->lock);
+	}
+
+	kernel_lock_retake(lock_depth);
+}
+
+void
+scheduler_switch_to_next(thread_t *dying)
+{
+	struct run_queue *rq = &run_queues[cpu_current_index()];
+
+	kernel_lock_drop();
+	ticket_lock(&rq->lock);
+
+	thread_t *next_thread = pick_next(rq, dying);
+
+	switch_to(rq, next_thread, &dying->cpu_state);
+	__builtin_unreachable();
+}
+
+bool
+scheduler_hold_page_directory(uint32_t pd)
+{
+	uint32_t self = cpu_current_index();
+
+	lock_all_queues();
+
+	for (uint32_t i = 0; i < nb_cpus; i++)
+	{
+		if (i != self && cpus[i].online && cpus[i].page_directory == pd)
+		{
+			scheduler_release_page_directory();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void
+scheduler_release_page_directory(void)
+{
+	unlock_all_queues();
+}
@@ -8,6 +8,8 @@
 #pragma once
 
 #include <lib/types.h>
+#include <lib/status.h>
+#include <lib/c/stdbool.h>
 #include "thread.h"
 
 void scheduler_setup(void);
@@ -15,4 +17,29 @@ void scheduler_insert_thread(thread_t * t);
 void scheduler_remove_thread(thread_t *t);
 void scheduler_start(void) __attribute__((noreturn));
 void schedule(void);
+// Timer interrupt: account the tick, balance the queues now and then.
+void scheduler_tick(void);
 void scheduler_switch_to_next(thread_t *dying) __attribute__((noreturn));
+
+/*
+ * Restrict t to the CPUs whose bit is set in mask, moving it off the
+ * current one if needed. Fails if no CPU in mask is online.
+ */
+status_t scheduler_set_affinity(thread_t *t, uint32_t mask);
+/*
+ * Make t a SCHED_FIFO or SCHED_RR thread of the given priority, from
+ * SCHED_RT_PRIO_MIN to SCHED_RT_PRIO_MAX, or a SCHED_NORMAL one (priority
+ * 0). It preempts whatever it now outranks.
+ */
+status_t scheduler_set_policy(thread_t *t, uint32_t policy, uint32_t priority);
+bool scheduler_policy_valid(uint32_t policy, uint32_t priority);
+// Fails unless THREAD_NICE_MIN <= nice <= THREAD_NICE_MAX.
+status_t scheduler_set_nice(thread_t *t, int nice);
+
+/*
+ * Keep every thread using page directory pd off the other CPUs until the
+ * release, so that its pages can be changed behind it. Fails, holding
+ * nothing, when one of them is running. Interrupts must be off.
+ */
+bool scheduler_hold_page_directory(uint32_t pd);
+void scheduler_release_page_directory(void);
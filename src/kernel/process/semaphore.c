@@ -7,8 +7,6 @@
 
 #include <lib/c/stdlib.h>
 #include <lib/c/string.h>
-#include <arch/x86/irq.h>
-#include <process/scheduler.h>
 
 #include "semaphore.h"
 
@@ -20,8 +18,8 @@ semaphore_create(int32_t value)
 	if (!semaphore)
 		return NULL;
 
-	semaphore->count = value;
-	TAILQ_INIT(&semaphore->waitqueue);
+	atomic_set(&semaphore->count, value);
+	wait_queue_init(&semaphore->waitqueue);
 
 	return semaphore;
 }
@@ -29,44 +27,48 @@ semaphore_create(int32_t value)
 void
 semaphore_destroy(semaphore_t *semaphore)
 {
-	thread_t *item;
+	free(semaphore);
+}
+
+// Take a unit if there is one.
+static bool
+semaphore_try_down(semaphore_t *semaphore)
+{
+	int32_t count = atomic_read(&semaphore->count);
 
-	while ((item = TAILQ_FIRST(&semaphore->waitqueue)))
+	while (count > 0)
 	{
-		TAILQ_REMOVE(&semaphore->waitqueue, item, next);
+		int32_t seen = atomic_cmpxchg(&semaphore->count, count,
+					      count - 1);
+
+		if (seen == count)
+			return true;
+		count = seen;
 	}
 
-	free(semaphore);
+	return false;
 }
 
 void
 semaphore_up(semaphore_t *semaphore)
 {
-	atomic_inc(semaphore->count);
+	atomic_inc(&semaphore->count);
+	wait_queue_wake_one(&semaphore->waitqueue);
+}
 
-	if (semaphore->count >= 0)
-	{
-		// Awake a blocked thread
-		thread_t *unblocked_thread = TAILQ_FIRST(&semaphore->waitqueue);
-		TAILQ_REMOVE(&semaphore->waitqueue, unblocked_thread, next);
-		scheduler_insert_thread(unblocked_thread);
-	}
+status_t
+semaphore_down_timeout(semaphore_t *semaphore, uint64_t timeout_ns)
+{
+	if (semaphore_try_down(semaphore))
+		return KERNEL_OK;
+
+	return wait_event_exclusive_timeout(&semaphore->waitqueue,
+					    semaphore_try_down(semaphore),
+					    timeout_ns);
 }
 
 void
 semaphore_down(semaphore_t *semaphore)
 {
-	if (semaphore->count >= 0)
-	{
-		atomic_dec(semaphore->count);
-	}
-	else
-	{
-		thread_t *current_thread = thread_get_current();
-
-		current_thread->state = THREAD_BLOCKED;
-		scheduler_remove_thread(current_thread);
-		TAILQ_INSERT_TAIL(&semaphore->waitqueue, current_thread, next);
-		schedule();
-	}
+	semaphore_down_timeout(semaphore, 0);
 }
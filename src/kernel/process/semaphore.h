@@ -11,15 +11,21 @@
 #include <lib/queue.h>
 #include <lib/types.h>
 #include <arch/x86/atomic.h>
-#include <process/thread.h>
+#include <process/wait_queue.h>
 
 typedef struct
 {
-	volatile atomic_count_t count;
-	TAILQ_HEAD(, thread) waitqueue;
+	atomic_t	count;
+	wait_queue_t	waitqueue;	/* exclusive: one unit, one thread */
 } semaphore_t;
 
 semaphore_t *semaphore_create(int32_t count);
 void semaphore_destroy(semaphore_t *semaphore);
 void semaphore_up(semaphore_t *semaphore);
 void semaphore_down(semaphore_t *semaphore);
+
+/*
+ * Like semaphore_down(), giving up after timeout_ns nanoseconds (0 waits
+ * forever) with -KERNEL_TIMED_OUT.
+ */
+status_t semaphore_down_timeout(semaphore_t *semaphore, uint64_t timeout_ns);
@@ -13,6 +13,10 @@
 #include <arch/x86/paging.h>
 #include <arch/x86/gdt.h>
 #include <arch/x86/syscall.h>
+#include <arch/x86/percpu.h>
+#include <arch/x86/spinlock.h>
+#include <memory/frame.h>
+#include <memory/object_pool.h>
 #include "thread.h"
 #include "scheduler.h"
 #include "process.h"
@@ -20,8 +24,26 @@
 extern void enter_user_mode(uint32_t, uint32_t);
 
 static TAILQ_HEAD(, thread) zombie_threads;
+static spinlock_t zombie_lock = SPINLOCK_INITIALIZER;
 
-static volatile thread_t *g_current_thread = NULL;
+/* Threads keep their kernel stack while cached in the pool. */
+static object_pool_t thread_pool;
+
+static status_t
+thread_ctor(void *object)
+{
+	thread_t *t = object;
+
+	t->stack_base_address = (uint32_t)malloc(THREAD_KERNEL_STACK_SIZE);
+
+	return t->stack_base_address ? KERNEL_OK : -KERNEL_NO_MEMORY;
+}
+
+static void
+thread_dtor(void *object)
+{
+	free((void *)((thread_t *)object)->stack_base_address);
+}
 
 static void
 thread_reap(void)
@@ -29,16 +51,16 @@ thread_reap(void)
 	uint32_t flags;
 	thread_t *z;
 
-	X86_IRQs_DISABLE(flags);
+	spin_lock_irqsave(&zombie_lock, flags);
 
-	while ((z = TAILQ_FIRST(&zombie_threads)) != NULL)
+	/* Until its context is saved, a zombie may still be on its stack. */
+	while ((z = TAILQ_FIRST(&zombie_threads)) != NULL && z->cpu_state)
 	{
 		TAILQ_REMOVE(&zombie_threads, z, zombie);
-		free((void *)z->stack_base_address);
-		free(z);
+		object_pool_free(&thread_pool, z);
 	}
 
-	X86_IRQs_ENABLE(flags);
+	spin_unlock_irqrestore(&zombie_lock, flags);
 }
 
 static void
@@ -49,6 +71,7 @@ idle_thread(uint32_t arg)
 	for (;;)
 	{
 		thread_reap();
+		frame_compact_idle();
 		asm volatile("sti; hlt" ::: "memory");
 	}
 }
@@ -67,22 +90,19 @@ static thread_t *
 thread_alloc_stack(const char *name)
 {
 	thread_t *t;
+	paddr_t stack;
 
-	t = malloc(sizeof(thread_t));
+	t = object_pool_alloc(&thread_pool);
 	if (!t)
 		return NULL;
 
+	stack = t->stack_base_address;
 	memset(t, 0, sizeof(*t));
 	strzcpy(t->name, ((name) ? name : "[NONAME]"), THREAD_MAX_NAMELEN);
 
-	t->stack_base_address = (uint32_t)malloc(THREAD_KERNEL_STACK_SIZE);
+	t->stack_base_address = stack;
 	t->stack_size = THREAD_KERNEL_STACK_SIZE;
-
-	if (!t->stack_base_address)
-	{
-		free(t);
-		return NULL;
-	}
+	t->affinity = THREAD_AFFINITY_ALL;
 
 	/* Needed before the first switch_to(): TSS.esp0 must be valid. */
 	t->kernel_stack_top = t->stack_base_address + t->stack_size;
@@ -119,21 +139,25 @@ thread_set_current(thread_t *current_thread)
 {
 	assert(current_thread->state == THREAD_READY);
 
-	g_current_thread        = current_thread;
-	g_current_thread->state = THREAD_RUNNING;
+	cpu_current()->current_thread = current_thread;
+	current_thread->state = THREAD_RUNNING;
 }
 
 thread_t *
 thread_get_current(void)
 {
+	thread_t *current_thread = cpu_current()->current_thread;
+
 	/*
 	 * BLOCKED is allowed: wait/sem set that state before schedule(),
-	 * which still needs to identify the outgoing thread.
+	 * which still needs to identify the outgoing thread. So is READY:
+	 * another CPU may wake it up before it gets there.
 	 */
-	assert(g_current_thread != NULL);
-	assert(g_current_thread->state == THREAD_RUNNING
-	    || g_current_thread->state == THREAD_BLOCKED);
-	return (thread_t *)g_current_thread;
+	assert(current_thread != NULL);
+	assert(current_thread->state == THREAD_RUNNING
+	    || current_thread->state == THREAD_BLOCKED
+	    || current_thread->state == THREAD_READY);
+	return current_thread;
 }
 
 void
@@ -141,12 +165,31 @@ threading_setup(void)
 {
 	TAILQ_INIT(&zombie_threads);
 
-	thread_t *idle = thread_kernel_create("idle", idle_thread, NULL);
+	status_t status = object_pool_init(&thread_pool, "thread",
+			sizeof(thread_t), thread_ctor, thread_dtor);
+	assert(status == KERNEL_OK);
+
+	thread_t *idle = thread_idle_create(0);
 	assert(idle != NULL);
 
 	thread_set_current(idle);
 }
 
+thread_t *
+thread_idle_create(uint32_t cpu)
+{
+	thread_t *idle = thread_alloc("idle", idle_thread, NULL);
+
+	if (!idle)
+		return NULL;
+
+	/* Ready, but only ever picked by its own CPU */
+	idle->state = THREAD_READY;
+	cpus[cpu].idle_thread = idle;
+
+	return idle;
+}
+
 thread_t *
 thread_kernel_create(const char *name,
 		kernel_thread_start_routine_t start_func,
@@ -191,6 +234,7 @@ thread_t *
 thread_fork_create(const char *name, struct process *process,
 		   struct syscall_frame *parent_frame)
 {
+	thread_t *parent = thread_get_current();
 	thread_t *t;
 	struct syscall_frame *cframe;
 
@@ -215,7 +259,12 @@ thread_fork_create(const char *name, struct process *process,
 			(cpu_kstate_function_arg1_t *)thread_exit,
 			(uint32_t)NULL);
 
+	/* Scheduling attributes are inherited */
 	t->process = process;
+	t->affinity = parent->affinity;
+	t->nice = t->base_nice = parent->base_nice;
+	t->policy = t->base_policy = parent->base_policy;
+	t->rt_priority = t->base_rt_priority = parent->base_rt_priority;
 	process->thread = t;
 	scheduler_insert_thread(t);
 
@@ -229,7 +278,7 @@ thread_exit(void)
 
 	X86_IRQs_DISABLE(flags);
 
-	thread_t *self = (thread_t *)g_current_thread;
+	thread_t *self = cpu_current()->current_thread;
 
 	if (self->process)
 	{
@@ -239,8 +288,10 @@ thread_exit(void)
 
 	scheduler_remove_thread(self);
 
+	spin_lock(&zombie_lock);
 	self->state = THREAD_ZOMBIE;
 	TAILQ_INSERT_TAIL(&zombie_threads, self, zombie);
+	spin_unlock(&zombie_lock);
 
 	/* Never returns: switches to the next ready thread. */
 	scheduler_switch_to_next(self);
@@ -9,6 +9,7 @@
 
 #include <lib/queue.h>
 #include <lib/types.h>
+#include <lib/c/stdbool.h>
 #include <arch/x86/cpu-context.h>
 #include <memory/frame.h>
 
@@ -20,18 +21,47 @@
 
 #define THREAD_MAX_NAMELEN 32
 
+/*
+ * Affinity mask of a new thread: it may run on any CPU
+ */
+#define THREAD_AFFINITY_ALL 0xFFFFFFFF
+
+/*
+ * Range of nice values, the lowest being the most favoured
+ */
+#define THREAD_NICE_MIN -16
+#define THREAD_NICE_MAX 15
+
+/*
+ * Scheduling policies
+ */
+#define SCHED_NORMAL	0	/* the policy chosen at build time */
+#define SCHED_FIFO	1	/* real time, runs until it blocks */
+#define SCHED_RR	2	/* real time, takes turns with its peers */
+
+/*
+ * Priorities of real-time threads, the highest being the most urgent
+ */
+#define SCHED_RT_PRIO_MIN 1
+#define SCHED_RT_PRIO_MAX 31
+
 /*
  * The possible states of a valid thread
  */
 typedef enum
 {
-	/* 0 = new thread after memset, not yet on the ready queue */
+	/* 0 = new thread after memset, not yet on a run queue */
 	THREAD_READY = 1,
 	THREAD_RUNNING,
 	THREAD_BLOCKED,
 	THREAD_ZOMBIE,
 } thread_state;
 
+/*
+ * Threads blocked on a semaphore, mutex, wait... see wait_queue.h
+ */
+TAILQ_HEAD(thread_queue, thread);
+
 /*
  * Definition of the function executed by a kernel thread
  */
@@ -47,8 +77,45 @@ typedef struct thread
 	struct cpu_state *cpu_state;
 	struct process  *process;
 	uint32_t        kernel_stack_top;
-	TAILQ_ENTRY(thread) next;		/* mutex/sem waitqueue */
-	TAILQ_ENTRY(thread) sched_next;		/* ready queue */
+	TAILQ_ENTRY(thread) next;		/* on its wait queue */
+	struct wait_queue *wait_queue;		/* the one it is on, if any */
+	bool		wait_exclusive;		/* to be woken one at a time */
+	status_t	wait_status;		/* of wait_queue_sleep() */
+	uint32_t	cpu;			/* whose run queue it is on */
+	bool		queued;			/* on it at all */
+	uint32_t	affinity;		/* CPUs it may run on, bit i for CPU i */
+	uint32_t	recent_ticks;		/* run time, halved as it ages */
+	int		nice;
+	uint32_t	policy;
+	uint32_t	rt_priority;		/* 0 for SCHED_NORMAL */
+	/* Priority inheritance (pi_mutex.c); the above may be boosted */
+	int		base_nice;		/* as set */
+	uint32_t	base_policy;
+	uint32_t	base_rt_priority;
+	struct pi_waiter *pi_blocked_on;	/* waiting for a pi_mutex_t */
+	LIST_HEAD(, pi_mutex) pi_held;		/* those with waiters */
+	/* Real-time class (sched_rt.c) */
+	bool		rt_queued;		/* there rather than in the policy */
+	uint32_t	rt_slice;		/* ticks left, SCHED_RR */
+	TAILQ_ENTRY(thread) rt_next;
+#ifdef CONFIG_SCHED_FAIR
+	/* Scheduling policy (sched_fair.c) */
+	uint64_t	vruntime;		/* weighted TSC cycles run */
+	int64_t		vlag;			/* to min_vruntime, off a queue */
+	uint64_t	exec_start;		/* TSC when last accounted */
+	uint64_t	slice_start;		/* TSC when its turn began */
+	uint32_t	weight;			/* of its nice value, when queued */
+	uint32_t	fair_height;		/* in the tree, 0 when not queued */
+	struct thread	*fair_left, *fair_right;
+#else
+	/* Scheduling policy (sched_prio.c) */
+	uint32_t	prio;			/* dynamic, 0 is the highest */
+	uint32_t	slice;			/* ticks left to run */
+	int		bonus;			/* levels earned by sleeping */
+	struct prio_array *prio_array;		/* NULL when not queued */
+	TAILQ_ENTRY(thread) prio_next;
+#endif
+	TAILQ_ENTRY(thread) sched_next;		/* run queue */
 	TAILQ_ENTRY(thread) zombie;
 } thread_t;
 
@@ -60,8 +127,11 @@ thread_t *thread_kernel_create(const char *name,
 		kernel_thread_start_routine_t start_func,
 		void *start_arg);
 thread_t *thread_user_create(const char *name, struct process *process);
+// Idle thread of a CPU, which runs it when no other thread is ready.
+thread_t *thread_idle_create(uint32_t cpu);
 thread_t *thread_fork_create(const char *name, struct process *process,
 			     struct syscall_frame *parent_frame);
 void thread_exit(void) __attribute__((noreturn));
 inline void thread_set_current(thread_t *current_thread);
 thread_t *thread_get_current(void);
+
@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/types.h>
+#include <lib/div64.h>
+#include <lib/c/string.h>
+#include <arch/x86/irq.h>
+#include <arch/x86/percpu.h>
+#include <arch/x86/spinlock.h>
+#include <arch/x86/kernel_lock.h>
+#include <arch/x86/tick.h>
+
+#include "scheduler.h"
+#include "timer.h"
+
+/*
+ * Each CPU has a hierarchical timing wheel. Level 0 has a slot per tick
+ * for the next WHEEL_SIZE ticks; each slot of level n covers as many
+ * ticks as the whole of level n - 1. Whenever level 0 comes round, the
+ * next slot of level 1 is spread over it, and so on up: adding or
+ * cancelling a timer is O(1), and a timer moves down at most
+ * WHEEL_LEVELS - 1 times.
+ *
+ * The tick may have been stopped for a while: the wheel then catches up
+ * tick after tick with tick_count(), or jumps there when it is empty.
+ */
+
+#define WHEEL_BITS	6
+#define WHEEL_SIZE	(1 << WHEEL_BITS)
+#define WHEEL_MASK	(WHEEL_SIZE - 1)
+#define WHEEL_LEVELS	4
+
+// Farther timers are run this far away, about 46 hours at 100 Hz
+#define WHEEL_MAX_DELAY	((1u << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+#define NSEC_PER_TICK	(1000000000 / TICK_HZ)
+
+struct timer_wheel
+{
+	spinlock_t	lock;
+	uint32_t	now;		/* next tick to run */
+	uint32_t	nb_timers;
+	struct timer * volatile running;	/* whose function is called */
+	LIST_HEAD(, timer) slots[WHEEL_LEVELS][WHEEL_SIZE];
+};
+
+static struct timer_wheel wheels[NB_CPUS];
+
+void
+timer_setup(void)
+{
+	uint32_t now = tick_count();
+
+	for (uint32_t cpu = 0; cpu < NB_CPUS; cpu++)
+	{
+		struct timer_wheel *w = &wheels[cpu];
+
+		spinlock_init(&w->lock);
+		w->now = now;
+		w->nb_timers = 0;
+		w->running = NULL;
+
+		for (uint32_t level = 0; level < WHEEL_LEVELS; level++)
+			for (uint32_t i = 0; i < WHEEL_SIZE; i++)
+				LIST_INIT(&w->slots[level][i]);
+	}
+}
+
+void
+timer_init(struct timer *timer, timer_function_t function, void *arg)
+{
+	memset(timer, 0, sizeof(*timer));
+	timer->function = function;
+	timer->arg = arg;
+}
+
+// An empty wheel has nothing to run on the way to the current tick.
+static void
+wheel_forward(struct timer_wheel *w, uint32_t now)
+{
+	if (w->nb_timers == 0)
+		w->now = now + 1;
+}
+
+// Slot of the lowest level whose range reaches timer->expires.
+static void
+wheel_insert(struct timer_wheel *w, struct timer *timer)
+{
+	uint32_t delay = timer->expires - w->now;
+	uint32_t level, index;
+
+	if ((int32_t)delay < 0)
+	{
+		// Already due: run at the next tick
+		level = 0;
+		index = w->now & WHEEL_MASK;
+	}
+	else
+	{
+		if (delay > WHEEL_MAX_DELAY)
+		{
+			delay = WHEEL_MAX_DELAY;
+			timer->expires = w->now + delay;
+		}
+
+		for (level = 0; level < WHEEL_LEVELS - 1; level++)
+		{
+			if (delay < 1u << (WHEEL_BITS * (level + 1)))
+				break;
+		}
+
+		index = (timer->expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+	}
+
+	LIST_INSERT_HEAD(&w->slots[level][index], timer, next);
+}
+
+// Spread the current slot of a level over the ones below it.
+static uint32_t
+cascade(struct timer_wheel *w, uint32_t level)
+{
+	uint32_t index = (w->now >> (WHEEL_BITS * level)) & WHEEL_MASK;
+	struct timer *timer;
+
+	while ((timer = LIST_FIRST(&w->slots[level][index])) != NULL)
+	{
+		LIST_REMOVE(timer, next);
+		wheel_insert(w, timer);
+	}
+
+	return index;
+}
+
+void
+timer_add(struct timer *timer, uint64_t delay_ns)
+{
+	uint32_t self = cpu_current_index();
+	struct timer_wheel *w = &wheels[self];
+	uint32_t delay, now, flags;
+
+	timer_cancel(timer);
+
+	if (delay_ns > (uint64_t)WHEEL_MAX_DELAY * NSEC_PER_TICK)
+		delay_ns = (uint64_t)WHEEL_MAX_DELAY * NSEC_PER_TICK;
+
+	// Rounded up, plus the tick already under way
+	delay = (uint32_t)div64_u32(delay_ns + NSEC_PER_TICK - 1,
+				    NSEC_PER_TICK, NULL) + 1;
+
+	spin_lock_irqsave(&w->lock, flags);
+
+	now = tick_count();
+	wheel_forward(w, now);
+
+	timer->expires = now + delay;
+	timer->cpu = self;
+	timer->pending = true;
+	wheel_insert(w, timer);
+	w->nb_timers++;
+
+	spin_unlock(&w->lock);
+
+	// Have its stopped tick reconsider when to come back
+	if (cpus[self].tick_stopped)
+		tick_start();
+
+	X86_IRQs_ENABLE(flags);
+}
+
+bool
+timer_cancel(struct timer *timer)
+{
+	struct timer_wheel *w = &wheels[timer->cpu];
+	bool pending;
+	uint32_t flags;
+
+	spin_lock_irqsave(&w->lock, flags);
+
+	pending = timer->pending;
+	if (pending)
+	{
+		LIST_REMOVE(timer, next);
+		timer->pending = false;
+		w->nb_timers--;
+	}
+
+	spin_unlock_irqrestore(&w->lock, flags);
+
+	return pending;
+}
+
+bool
+timer_cancel_sync(struct timer *timer)
+{
+	struct timer_wheel *w = &wheels[timer->cpu];
+	bool pending = timer_cancel(timer);
+
+	// Its function may be waiting for the kernel lock, held here
+	if (w->running == timer)
+	{
+		uint32_t depth = kernel_lock_drop();
+
+		while (w->running == timer)
+			asm volatile("pause" ::: "memory");
+
+		kernel_lock_retake(depth);
+	}
+
+	return pending;
+}
+
+void
+timer_run(void)
+{
+	struct timer_wheel *w = &wheels[cpu_current_index()];
+	uint32_t target = tick_count();
+	struct timer *timer;
+
+	spin_lock(&w->lock);
+
+	wheel_forward(w, target);
+
+	while ((int32_t)(target - w->now) >= 0)
+	{
+		uint32_t index = w->now & WHEEL_MASK;
+
+		if (index == 0 && cascade(w, 1) == 0 && cascade(w, 2) == 0)
+			cascade(w, 3);
+
+		w->now++;
+
+		while ((timer = LIST_FIRST(&w->slots[0][index])) != NULL)
+		{
+			timer_function_t function = timer->function;
+			void *arg = timer->arg;
+
+			LIST_REMOVE(timer, next);
+			timer->pending = false;
+			w->nb_timers--;
+			w->running = timer;
+
+			// The function may add timers, or take other locks
+			spin_unlock(&w->lock);
+
+			kernel_lock();
+			function(arg);
+			kernel_unlock();
+
+			spin_lock(&w->lock);
+			w->running = NULL;
+		}
+	}
+
+	spin_unlock(&w->lock);
+}
+
+static bool
+upper_levels_empty(const struct timer_wheel *w)
+{
+	for (uint32_t level = 1; level < WHEEL_LEVELS; level++)
+		for (uint32_t i = 0; i < WHEEL_SIZE; i++)
+			if (!LIST_EMPTY(&w->slots[level][i]))
+				return false;
+
+	return true;
+}
+
+uint32_t
+timer_next_tick(void)
+{
+	struct timer_wheel *w = &wheels[cpu_current_index()];
+	uint32_t now = tick_count();
+	uint32_t next = WHEEL_SIZE;
+	uint32_t ticks;
+
+	spin_lock(&w->lock);
+
+	if (w->nb_timers == 0)
+	{
+		spin_unlock(&w->lock);
+		return 0;
+	}
+
+	// A level 0 slot holds the timers of a single tick
+	for (uint32_t i = 0; i < WHEEL_SIZE; i++)
+	{
+		if (!LIST_EMPTY(&w->slots[0][(w->now + i) & WHEEL_MASK]))
+		{
+			next = i;
+			break;
+		}
+	}
+
+	// Timers from above come down when level 0 comes round
+	if (!upper_levels_empty(w))
+	{
+		uint32_t cascade = (WHEEL_SIZE - (w->now & WHEEL_MASK))
+			& WHEEL_MASK;
+
+		if (cascade < next)
+			next = cascade;
+	}
+
+	// Counted from the current tick, which the wheel may lag behind
+	ticks = w->now + next - now;
+
+	spin_unlock(&w->lock);
+
+	return (int32_t)ticks > 0 ? ticks : 1;
+}
+
+static void
+wake_up(void *arg)
+{
+	scheduler_insert_thread(arg);
+}
+
+void
+timer_sleep(uint64_t ns)
+{
+	thread_t *current = thread_get_current();
+	struct timer timer;
+
+	timer_init(&timer, wake_up, current);
+
+	current->state = THREAD_BLOCKED;
+	scheduler_remove_thread(current);
+	timer_add(&timer, ns);
+	schedule();
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <lib/queue.h>
+#include <lib/types.h>
+#include <lib/status.h>
+#include <lib/c/stdbool.h>
+
+typedef void (*timer_function_t)(void *arg);
+
+struct timer
+{
+	LIST_ENTRY(timer) next;		/* in its wheel slot */
+	uint32_t	expires;	/* tick, see tick_count() */
+	uint32_t	cpu;		/* whose wheel it is on */
+	bool		pending;
+	timer_function_t function;
+	void		*arg;
+};
+
+void timer_setup(void);
+
+void timer_init(struct timer *timer, timer_function_t function, void *arg);
+
+/*
+ * Call the function of timer once, after delay_ns nanoseconds rounded up
+ * to the next tick, from the tick interrupt of the current CPU, under the
+ * kernel lock. A pending timer is moved. The function may add it again.
+ */
+void timer_add(struct timer *timer, uint64_t delay_ns);
+
+/*
+ * Returns whether timer was still pending. If not, its function may be
+ * running on another CPU.
+ */
+bool timer_cancel(struct timer *timer);
+
+/*
+ * Same, but also wait for its function to return if it runs, letting go
+ * of the kernel lock meanwhile: afterwards the timer may be freed.
+ */
+bool timer_cancel_sync(struct timer *timer);
+
+// Block the current thread for at least ns nanoseconds.
+void timer_sleep(uint64_t ns);
+
+// Tick interrupt: run the timers of the current CPU that are due.
+void timer_run(void);
+
+/*
+ * Ticks until the current CPU has a timer to run, 0 if it has none, for
+ * its tick to be stopped until then.
+ */
+uint32_t timer_next_tick(void);
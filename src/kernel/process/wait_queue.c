@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/c/string.h>
+#include <arch/x86/clock.h>
+
+#include "wait_queue.h"
+#include "scheduler.h"
+#include "timer.h"
+
+void
+wait_queue_init(wait_queue_t *wq)
+{
+	spinlock_init(&wq->lock);
+	TAILQ_INIT(&wq->threads);
+}
+
+// Called with wq locked.
+static void
+enqueue_current(wait_queue_t *wq, bool exclusive)
+{
+	thread_t *current = thread_get_current();
+
+	if (current->wait_queue != wq)
+	{
+		current->wait_queue = wq;
+		current->wait_exclusive = exclusive;
+		current->wait_status = KERNEL_OK;
+		TAILQ_INSERT_TAIL(&wq->threads, current, next);
+	}
+}
+
+void
+wait_queue_prepare(wait_queue_t *wq, bool exclusive)
+{
+	uint32_t flags;
+
+	spin_lock_irqsave(&wq->lock, flags);
+	enqueue_current(wq, exclusive);
+	spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+// Called with wq locked.
+static void
+wake_thread(wait_queue_t *wq, thread_t *t)
+{
+	TAILQ_REMOVE(&wq->threads, t, next);
+	t->wait_queue = NULL;
+
+	// Not blocked yet: wait_queue_sleep() will see it is off the queue
+	if (t->state == THREAD_BLOCKED)
+		scheduler_insert_thread(t);
+}
+
+static void
+wait_timeout(void *arg)
+{
+	thread_t *t = arg;
+	wait_queue_t *wq = t->wait_queue;
+	uint32_t flags;
+
+	// Woken up first
+	if (!wq)
+		return;
+
+	spin_lock_irqsave(&wq->lock, flags);
+
+	if (t->wait_queue == wq)
+	{
+		t->wait_status = -KERNEL_TIMED_OUT;
+		wake_thread(wq, t);
+	}
+
+	spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+status_t
+wait_queue_sleep(wait_queue_t *wq, uint64_t timeout_ns)
+{
+	thread_t *current = thread_get_current();
+	struct timer timer;
+	bool blocked = false;
+	uint32_t flags;
+
+	spin_lock_irqsave(&wq->lock, flags);
+
+	if (current->wait_queue == wq)
+	{
+		current->state = THREAD_BLOCKED;
+		scheduler_remove_thread(current);
+		blocked = true;
+	}
+
+	spin_unlock_irqrestore(&wq->lock, flags);
+
+	if (!blocked)
+		return current->wait_status;
+
+	if (timeout_ns != 0)
+	{
+		timer_init(&timer, wait_timeout, current);
+		timer_add(&timer, timeout_ns);
+	}
+
+	schedule();
+
+	// The timer lives on this stack: it must be done with it
+	if (timeout_ns != 0)
+		timer_cancel_sync(&timer);
+
+	return current->wait_status;
+}
+
+void
+wait_queue_finish(wait_queue_t *wq)
+{
+	thread_t *current = thread_get_current();
+	uint32_t flags;
+
+	spin_lock_irqsave(&wq->lock, flags);
+
+	if (current->wait_queue == wq)
+	{
+		TAILQ_REMOVE(&wq->threads, current, next);
+		current->wait_queue = NULL;
+	}
+
+	spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+// Called with wq locked.
+static uint32_t
+wake_threads(wait_queue_t *wq, uint32_t nr_exclusive)
+{
+	thread_t *t, *next;
+	uint32_t woken = 0;
+
+	for (t = TAILQ_FIRST(&wq->threads); t; t = next)
+	{
+		next = TAILQ_NEXT(t, next);
+
+		if (t->wait_exclusive)
+		{
+			if (nr_exclusive == 0)
+				continue;
+			nr_exclusive--;
+		}
+
+		wake_thread(wq, t);
+		woken++;
+	}
+
+	return woken;
+}
+
+uint32_t
+wait_queue_wake(wait_queue_t *wq, uint32_t nr_exclusive)
+{
+	uint32_t woken;
+	uint32_t flags;
+
+	spin_lock_irqsave(&wq->lock, flags);
+	woken = wake_threads(wq, nr_exclusive);
+	spin_unlock_irqrestore(&wq->lock, flags);
+
+	return woken;
+}
+
+void
+wait_queue_wake_locked(wait_queue_t *wq, thread_t *t)
+{
+	wake_thread(wq, t);
+}
+
+uint64_t
+wait_queue_deadline(uint64_t timeout_ns)
+{
+	return timeout_ns ? clock_monotonic_ns() + timeout_ns : 0;
+}
+
+status_t
+wait_queue_sleep_until(wait_queue_t *wq, uint64_t deadline_ns)
+{
+	uint64_t now;
+
+	if (deadline_ns == 0)
+		return wait_queue_sleep(wq, 0);
+
+	now = clock_monotonic_ns();
+	if (now >= deadline_ns)
+		return -KERNEL_TIMED_OUT;
+
+	return wait_queue_sleep(wq, deadline_ns - now);
+}
+
+void
+completion_init(struct completion *c)
+{
+	c->done = 0;
+	wait_queue_init(&c->wait);
+}
+
+void
+complete(struct completion *c)
+{
+	uint32_t flags;
+
+	spin_lock_irqsave(&c->wait.lock, flags);
+	c->done++;
+	wake_threads(&c->wait, 1);
+	spin_unlock_irqrestore(&c->wait.lock, flags);
+}
+
+void
+wait_for_completion(struct completion *c)
+{
+	uint32_t flags;
+
+	for (;;)
+	{
+		spin_lock_irqsave(&c->wait.lock, flags);
+
+		if (c->done > 0)
+		{
+			c->done--;
+			break;
+		}
+
+		enqueue_current(&c->wait, true);
+		spin_unlock_irqrestore(&c->wait.lock, flags);
+
+		wait_queue_sleep(&c->wait, 0);
+	}
+
+	// Off the queue: wait_queue_sleep() returns once complete() took us off
+	spin_unlock_irqrestore(&c->wait.lock, flags);
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Wait queues: threads sleep on one until a condition holds, and whoever
+ * makes it hold wakes them up.
+ *
+ * A thread gets on the queue before it checks the condition, and only
+ * blocks if nobody took it off meanwhile: a wakeup between the check and
+ * the sleep is not lost. Exclusive waiters are woken one at a time, for
+ * resources only one of them can take; the others are all woken up.
+ *
+ * Each queue has its own lock, taken with interrupts off, so that wakeups
+ * may come from interrupt handlers and do not need the kernel lock.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+#include <lib/queue.h>
+#include <lib/status.h>
+#include <lib/c/stdbool.h>
+#include <arch/x86/spinlock.h>
+
+#include "thread.h"
+
+typedef struct wait_queue
+{
+	spinlock_t		lock;
+	struct thread_queue	threads;
+} wait_queue_t;
+
+#define WAIT_QUEUE_INITIALIZER(wq) \
+	{ SPINLOCK_INITIALIZER, TAILQ_HEAD_INITIALIZER((wq).threads) }
+
+#define WAKE_ALL	0xFFFFFFFF
+
+void wait_queue_init(wait_queue_t *wq);
+
+// Put the current thread on wq, unless it is there already.
+void wait_queue_prepare(wait_queue_t *wq, bool exclusive);
+
+/*
+ * Block until woken up, or for at most timeout_ns nanoseconds unless 0,
+ * after wait_queue_prepare(). Returns at once if woken up already, with
+ * KERNEL_OK, or -KERNEL_TIMED_OUT. The thread is off wq either way.
+ */
+status_t wait_queue_sleep(wait_queue_t *wq, uint64_t timeout_ns);
+
+// Take the current thread off wq if it is still there.
+void wait_queue_finish(wait_queue_t *wq);
+
+/*
+ * Wake up the non-exclusive waiters and the first nr_exclusive exclusive
+ * ones. Returns how many threads were woken up.
+ */
+uint32_t wait_queue_wake(wait_queue_t *wq, uint32_t nr_exclusive);
+
+#define wait_queue_wake_one(wq)	wait_queue_wake((wq), 1)
+#define wait_queue_wake_all(wq)	wait_queue_wake((wq), WAKE_ALL)
+
+/*
+ * Wake up t, a waiter on wq, with wq->lock held: the caller may hand it
+ * what it waits for under the same lock, before it can look.
+ */
+void wait_queue_wake_locked(wait_queue_t *wq, struct thread *t);
+
+/*
+ * For wait_event(): a monotonic deadline timeout_ns from now, 0 for none,
+ * and wait_queue_sleep() until then, -KERNEL_TIMED_OUT once it passed.
+ */
+uint64_t wait_queue_deadline(uint64_t timeout_ns);
+status_t wait_queue_sleep_until(wait_queue_t *wq, uint64_t deadline_ns);
+
+/*
+ * Sleep on wq until condition holds, checking it every time the thread is
+ * woken up, or for at most timeout_ns nanoseconds unless 0. Evaluates to
+ * KERNEL_OK once condition holds, else -KERNEL_TIMED_OUT.
+ */
+#define __wait_event(wq, condition, exclusive, timeout_ns)		\
+({									\
+	uint64_t __deadline = wait_queue_deadline(timeout_ns);		\
+	status_t __status;						\
+									\
+	for (;;)							\
+	{								\
+		wait_queue_prepare((wq), (exclusive));			\
+		if (condition)						\
+		{							\
+			__status = KERNEL_OK;				\
+			break;						\
+		}							\
+		__status = wait_queue_sleep_until((wq), __deadline);	\
+		/* Last look off the queue, not to swallow a wakeup */	\
+		if (__status != KERNEL_OK)				\
+		{							\
+			wait_queue_finish(wq);				\
+			if (condition)					\
+				__status = KERNEL_OK;			\
+			break;						\
+		}							\
+	}								\
+									\
+	wait_queue_finish(wq);						\
+	__status;							\
+})
+
+#define wait_event(wq, condition) \
+	__wait_event((wq), (condition), false, 0)
+
+#define wait_event_timeout(wq, condition, timeout_ns) \
+	__wait_event((wq), (condition), false, (timeout_ns))
+
+#define wait_event_exclusive(wq, condition) \
+	__wait_event((wq), (condition), true, 0)
+
+#define wait_event_exclusive_timeout(wq, condition, timeout_ns) \
+	__wait_event((wq), (condition), true, (timeout_ns))
+
+/*
+ * Completions: a count of events that threads wait for. Unlike a flag
+ * checked with wait_event(), complete() is done with the completion once
+ * its waiter sees the event, which may then free it, as on its stack.
+ */
+struct completion
+{
+	uint32_t	done;		/* events not waited for yet */
+	wait_queue_t	wait;		/* its lock covers done */
+};
+
+void completion_init(struct completion *c);
+// Signal an event, waking up one waiter.
+void complete(struct completion *c);
+// Wait for an event, and consume it.
+void wait_for_completion(struct completion *c);
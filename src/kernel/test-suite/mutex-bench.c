@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <lib/types.h>
+#include <lib/div64.h>
+#include <lib/c/assert.h>
+#include <lib/c/stdio.h>
+#include <arch/x86/irq.h>
+#include <arch/x86/kernel_lock.h>
+#include <arch/x86/percpu.h>
+#include <arch/x86/tsc.h>
+#include <process/mutex.h>
+#include <process/scheduler.h>
+#include <process/semaphore.h>
+#include <process/thread.h>
+
+#include "mutex-bench.h"
+
+static mutex_t *bench_lock;
+static semaphore_t *bench_done;
+static uint32_t bench_iterations;
+static volatile uint32_t bench_counter;
+
+static void
+bench_worker(uint32_t arg)
+{
+	uint32_t flags;
+
+	(void)arg;
+
+	for (uint32_t i = 0; i < bench_iterations; i++)
+	{
+		mutex_lock(bench_lock);
+		bench_counter++;
+		mutex_unlock(bench_lock);
+	}
+
+	X86_IRQs_DISABLE(flags);
+	kernel_lock();
+	semaphore_up(bench_done);
+	kernel_unlock();
+	X86_IRQs_ENABLE(flags);
+}
+
+void
+bench_mutex(uint32_t nb_threads, uint32_t iterations)
+{
+	uint64_t start, cycles;
+	uint32_t flags;
+
+	bench_lock = mutex_create();
+	bench_done = semaphore_create(0);
+	assert(bench_lock != NULL && bench_done != NULL);
+
+	bench_iterations = iterations;
+	bench_counter = 0;
+
+	start = rdtsc();
+
+	for (uint32_t i = 0; i < nb_threads; i++)
+	{
+		thread_t *t = thread_kernel_create("mutex-bench", bench_worker,
+						   0);
+
+		assert(t != NULL);
+		scheduler_set_affinity(t, 1u << (i % nb_cpus));
+	}
+
+	X86_IRQs_DISABLE(flags);
+	kernel_lock();
+	for (uint32_t i = 0; i < nb_threads; i++)
+		semaphore_down(bench_done);
+	kernel_unlock();
+	X86_IRQs_ENABLE(flags);
+
+	cycles = rdtsc() - start;
+
+	assert(bench_counter == nb_threads * iterations);
+
+	kprintf("mutex: %u threads x %u: %u cycles per lock/unlock\n",
+		(unsigned int)nb_threads, (unsigned int)iterations,
+		(unsigned int)div64_u32(cycles, nb_threads * iterations,
+					NULL));
+
+	semaphore_destroy(bench_done);
+	mutex_destroy(bench_lock);
+}
@@ -0,0 +1,17 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <lib/types.h>
+
+/*
+ * Have nb_threads kernel threads, spread over the CPUs, take and release
+ * a single mutex iterations times each, then print the average cost of a
+ * lock/unlock pair. To be called from a kernel thread.
+ */
+void bench_mutex(uint32_t nb_threads, uint32_t iterations);
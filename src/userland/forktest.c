@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Protections must survive fork(): a child touching a PROT_NONE page of
+ * its parent has to fault, and get killed, as the parent would. Shared
+ * anonymous pages must be shared with the child, and so must the mutexes
+ * placed there.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <mman.h>
+#include <sync.h>
+
+#define PAGE_SIZE	4096
+
+/* Increments by each of the parent and the child */
+#define INCREMENTS	100000
+
+struct shared
+{
+	mutex_t			lock;
+	volatile uint32_t	count;
+};
+
+/* Exit status of a child that reads, or writes, the page at guard. */
+static int
+touch_in_child(volatile char *guard, int write)
+{
+	int status = 0;
+	int pid = fork();
+
+	if (pid == 0)
+	{
+		if (write)
+			*guard = 1;
+		else
+			(void)*guard;
+		exit(0);
+	}
+
+	if (pid < 0)
+		return 0;
+
+	wait(&status);
+	return status;
+}
+
+// Whether parent and child both counted, through a shared mapping.
+static int
+count_with_child(void)
+{
+	struct shared *shared;
+	int status = 0;
+	int pid;
+
+	shared = mmap(0, PAGE_SIZE, PROT_READ | PROT_WRITE,
+		      MAP_SHARED | MAP_ANONYMOUS, 0, 0);
+	if (shared == MAP_FAILED)
+		return 0;
+
+	mutex_init(&shared->lock);
+	shared->count = 0;
+
+	pid = fork();
+	if (pid < 0)
+		return 0;
+
+	for (uint32_t i = 0; i < INCREMENTS; i++)
+	{
+		mutex_lock(&shared->lock);
+		shared->count = shared->count + 1;
+		mutex_unlock(&shared->lock);
+	}
+
+	if (pid == 0)
+		exit(0);
+
+	wait(&status);
+	return status == 0 && shared->count == 2 * INCREMENTS;
+}
+
+int main(int argc, char **argv)
+{
+	volatile char *guard;
+	int failed = 0;
+
+	(void)argc;
+	(void)argv;
+
+	guard = mmap(0, PAGE_SIZE, PROT_READ | PROT_WRITE,
+		     MAP_PRIVATE | MAP_ANONYMOUS, 0, 0);
+	if (guard == MAP_FAILED)
+	{
+		printf("forktest: mmap failed\n");
+		exit(1);
+	}
+
+	/* Present and writable before being locked away */
+	*guard = 0;
+
+	if (mprotect((void *)guard, PAGE_SIZE, PROT_NONE) < 0)
+	{
+		printf("forktest: mprotect failed\n");
+		exit(1);
+	}
+
+	if (touch_in_child(guard, 0) == 0)
+	{
+		printf("forktest: child read a PROT_NONE page\n");
+		failed = 1;
+	}
+
+	if (touch_in_child(guard, 1) == 0)
+	{
+		printf("forktest: child wrote a PROT_NONE page\n");
+		failed = 1;
+	}
+
+	if (!count_with_child())
+	{
+		printf("forktest: child did not share a MAP_SHARED page\n");
+		failed = 1;
+	}
+
+	printf("forktest: %s\n", failed ? "FAILED" : "passed");
+	exit(failed);
+	return 0;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include "futex.h"
+
+#define SYS_FUTEX	19
+
+#define FUTEX_WAIT	0
+#define FUTEX_WAKE	1
+#define FUTEX_REQUEUE	2
+
+int
+futex_wait(uint32_t *uaddr, uint32_t value, const struct timespec *timeout)
+{
+	int ret;
+
+	asm volatile("int $0x80"
+		: "=a"(ret)
+		: "a"(SYS_FUTEX), "b"(uaddr), "c"(FUTEX_WAIT), "d"(value),
+		  "S"(timeout)
+		: "memory");
+	return ret;
+}
+
+int
+futex_wake(uint32_t *uaddr, uint32_t count)
+{
+	int ret;
+
+	asm volatile("int $0x80"
+		: "=a"(ret)
+		: "a"(SYS_FUTEX), "b"(uaddr), "c"(FUTEX_WAKE), "d"(count)
+		: "memory");
+	return ret;
+}
+
+int
+futex_requeue(uint32_t *uaddr, uint32_t count, uint32_t *uaddr2,
+	      uint32_t requeue_count)
+{
+	int ret;
+
+	asm volatile("int $0x80"
+		: "=a"(ret)
+		: "a"(SYS_FUTEX), "b"(uaddr), "c"(FUTEX_REQUEUE), "d"(count),
+		  "S"(requeue_count), "D"(uaddr2)
+		: "memory");
+	return ret;
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Futexes: sleeping on a 32-bit word until another thread says it changed.
+ * The word may live in a MAP_SHARED | MAP_ANONYMOUS mapping, for a process
+ * and its children to meet there.
+ * See sync.h for locks built on top of them.
+ */
+
+#pragma once
+
+#include "stdint.h"
+#include "time.h"
+
+/*
+ * Sleep as long as *uaddr holds value, until futex_wake() or for at most
+ * timeout unless NULL. Returns 0 once woken, or -1 if *uaddr held
+ * something else, on timeout or on a bad address; callers check the word
+ * again either way.
+ */
+int futex_wait(uint32_t *uaddr, uint32_t value,
+	       const struct timespec *timeout);
+
+/* Wake up to count sleepers on uaddr. Returns how many, or -1. */
+int futex_wake(uint32_t *uaddr, uint32_t count);
+
+/*
+ * Wake up to count sleepers on uaddr and move up to requeue_count others
+ * to uaddr2, so that futex_wake(uaddr2) wakes them up. Returns how many
+ * were woken, or -1.
+ */
+int futex_requeue(uint32_t *uaddr, uint32_t count, uint32_t *uaddr2,
+		  uint32_t requeue_count);
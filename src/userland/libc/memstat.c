@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include "memstat.h"
+
+#define SYS_MEMSTAT	12
+
+int
+memstat(int source, int index, void *buf)
+{
+	int ret;
+
+	asm volatile("int $0x80"
+		: "=a"(ret)
+		: "a"(SYS_MEMSTAT), "b"(source), "c"(index), "d"(buf)
+		: "memory");
+	return ret;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include "stdint.h"
+
+/* Layouts match the kernel's struct frame_stats, heap_stats, pool_stats. */
+
+#define MEMSTAT_FRAMES	0
+#define MEMSTAT_HEAP	1
+#define MEMSTAT_POOL	2
+#define MEMSTAT_PROFILE	3	/* kernel prints its heap profile */
+
+#define FRAME_STAT_ORDERS	11
+#define HEAP_STAT_CLASSES	16
+#define POOL_NAME_LENGTH	16
+
+struct frame_stats {
+	uint32_t total_frames;
+	uint32_t free_frames;
+	uint32_t peak_used_frames;
+	uint32_t allocs[FRAME_STAT_ORDERS];
+	uint32_t frees[FRAME_STAT_ORDERS];
+	uint32_t failures[FRAME_STAT_ORDERS];
+	uint32_t free_runs[FRAME_STAT_ORDERS];
+	uint32_t fragmentation[FRAME_STAT_ORDERS];	/* per mille */
+	uint32_t compactions;
+	uint32_t migrated_pages;
+};
+
+struct heap_stats {
+	uint32_t allocs[HEAP_STAT_CLASSES];	/* up to 16 << i bytes */
+	uint32_t frees[HEAP_STAT_CLASSES];
+	uint32_t failures;
+	uint32_t live_allocations;
+	uint32_t live_bytes;
+	uint32_t peak_bytes;
+	uint32_t live_pages;
+	uint32_t peak_pages;
+};
+
+struct pool_stats {
+	char name[POOL_NAME_LENGTH];
+	uint32_t block_size;
+	uint32_t nb_blocks;
+	uint32_t used;
+	uint32_t peak_used;
+	uint32_t allocs;
+	uint32_t frees;
+	uint32_t failures;
+};
+
+/*
+ * Copy the statistics of source into buf (index selects the pool). Returns
+ * the number of bytes written, or -1.
+ */
+int memstat(int source, int index, void *buf);
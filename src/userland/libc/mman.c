@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include "mman.h"
+
+#define SYS_MMAP	9
+#define SYS_MUNMAP	10
+#define SYS_MPROTECT	11
+
+/* Matches struct mmap_args in the kernel. */
+struct mmap_args {
+	uint32_t addr;
+	uint32_t length;
+	uint32_t prot;
+	uint32_t flags;
+	uint32_t path;
+	uint32_t offset;
+};
+
+void *
+mmap(void *addr, size_t length, int prot, int flags, const char *path,
+     size_t offset)
+{
+	struct mmap_args args = {
+		(uint32_t)addr, length, (uint32_t)prot, (uint32_t)flags,
+		(uint32_t)path, offset
+	};
+	void *ret;
+
+	asm volatile("int $0x80"
+		: "=a"(ret)
+		: "a"(SYS_MMAP), "b"(&args)
+		: "memory");
+	return ret;
+}
+
+int
+munmap(void *addr, size_t length)
+{
+	int ret;
+
+	asm volatile("int $0x80"
+		: "=a"(ret)
+		: "a"(SYS_MUNMAP), "b"(addr), "c"(length)
+		: "memory");
+	return ret;
+}
+
+int
+mprotect(void *addr, size_t length, int prot)
+{
+	int ret;
+
+	asm volatile("int $0x80"
+		: "=a"(ret)
+		: "a"(SYS_MPROTECT), "b"(addr), "c"(length), "d"(prot)
+		: "memory");
+	return ret;
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include "stdint.h"
+
+typedef uint32_t size_t;
+
+#define PROT_NONE	0x0
+#define PROT_READ	0x1
+#define PROT_WRITE	0x2
+#define PROT_EXEC	0x4
+
+#define MAP_SHARED	0x01
+#define MAP_PRIVATE	0x02
+#define MAP_FIXED	0x10
+#define MAP_ANONYMOUS	0x20
+
+#define MAP_FAILED	((void *)-1)
+
+/*
+ * There are no file descriptors for tarfs files yet: file mappings name the
+ * file by path. Pass NULL for anonymous memory, which is either
+ * MAP_PRIVATE, copied by fork(), or MAP_SHARED with the children. File
+ * mappings are read-only views of the initrd and may return an address
+ * that is not page aligned.
+ */
+void *mmap(void *addr, size_t length, int prot, int flags, const char *path,
+	   size_t offset);
+int munmap(void *addr, size_t length);
+int mprotect(void *addr, size_t length, int prot);
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include "sched.h"
+
+#define SYS_SCHED_SETAFFINITY	13
+#define SYS_SETNICE		14
+#define SYS_SCHED_SETSCHEDULER	15
+
+int
+sched_setaffinity(int pid, uint32_t mask)
+{
+	int ret;
+
+	asm volatile("int $0x80"
+		: "=a"(ret)
+		: "a"(SYS_SCHED_SETAFFINITY), "b"(pid), "c"(mask)
+		: "memory");
+	return ret;
+}
+
+int
+setnice(int pid, int nice)
+{
+	int ret;
+
+	asm volatile("int $0x80"
+		: "=a"(ret)
+		: "a"(SYS_SETNICE), "b"(pid), "c"(nice)
+		: "memory");
+	return ret;
+}
+
+int
+sched_setscheduler(int pid, int policy, int priority)
+{
+	int ret;
+
+	asm volatile("int $0x80"
+		: "=a"(ret)
+		: "a"(SYS_SCHED_SETSCHEDULER), "b"(pid), "c"(policy),
+		  "d"(priority)
+		: "memory");
+	return ret;
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include "stdint.h"
+
+/* Scheduling policies, as in the kernel's thread.h */
+#define SCHED_NORMAL	0
+#define SCHED_FIFO	1
+#define SCHED_RR	2
+
+#define SCHED_RT_PRIO_MIN	1
+#define SCHED_RT_PRIO_MAX	31
+
+/*
+ * Let process pid (0 for the caller) run only on the CPUs whose bit is set
+ * in mask, bit i standing for CPU i. Returns 0, or -1 if there is no such
+ * process or none of these CPUs is online.
+ */
+int sched_setaffinity(int pid, uint32_t mask);
+
+/*
+ * Set the nice value of process pid (0 for the caller), from -16 (most
+ * favoured) to 15. Returns 0, or -1 if there is no such process or the
+ * value is out of range.
+ */
+int setnice(int pid, int nice);
+
+/*
+ * Make process pid (0 for the caller) a real-time SCHED_FIFO or SCHED_RR
+ * process of the given priority, the highest being the most urgent, or a
+ * SCHED_NORMAL one with priority 0. Returns 0, or -1.
+ */
+int sched_setscheduler(int pid, int policy, int priority);
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include "sync.h"
+#include "futex.h"
+
+#define MUTEX_UNLOCKED	0
+#define MUTEX_LOCKED	1
+#define MUTEX_CONTENDED	2
+
+#define ALL		0x7FFFFFFF
+
+void
+mutex_init(mutex_t *m)
+{
+	m->state = MUTEX_UNLOCKED;
+}
+
+/*
+ * Take m, marking it contended: whoever held it may not know about us, or
+ * about the waiters cond_broadcast() moved onto it.
+ */
+static void
+mutex_lock_contended(mutex_t *m)
+{
+	while (__atomic_exchange_n(&m->state, MUTEX_CONTENDED,
+				   __ATOMIC_ACQUIRE) != MUTEX_UNLOCKED)
+		futex_wait(&m->state, MUTEX_CONTENDED, 0);
+}
+
+void
+mutex_lock(mutex_t *m)
+{
+	uint32_t state = MUTEX_UNLOCKED;
+
+	if (__atomic_compare_exchange_n(&m->state, &state, MUTEX_LOCKED, 0,
+					__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return;
+
+	mutex_lock_contended(m);
+}
+
+int
+mutex_trylock(mutex_t *m)
+{
+	uint32_t state = MUTEX_UNLOCKED;
+
+	return __atomic_compare_exchange_n(&m->state, &state, MUTEX_LOCKED, 0,
+					   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
+		? 0 : -1;
+}
+
+void
+mutex_unlock(mutex_t *m)
+{
+	// Nobody sleeps unless it said so
+	if (__atomic_exchange_n(&m->state, MUTEX_UNLOCKED, __ATOMIC_RELEASE)
+	    == MUTEX_CONTENDED)
+		futex_wake(&m->state, 1);
+}
+
+void
+cond_init(cond_t *c)
+{
+	c->sequence = 0;
+	c->mutex = 0;
+}
+
+int
+cond_timedwait(cond_t *c, mutex_t *m, const struct timespec *timeout)
+{
+	uint32_t sequence = __atomic_load_n(&c->sequence, __ATOMIC_RELAXED);
+	int ret;
+
+	c->mutex = m;
+	mutex_unlock(m);
+
+	// Fails at once if signalled since we read the sequence
+	ret = futex_wait(&c->sequence, sequence, timeout);
+	if (ret != 0
+	    && __atomic_load_n(&c->sequence, __ATOMIC_RELAXED) != sequence)
+		ret = 0;
+
+	mutex_lock_contended(m);
+
+	return ret;
+}
+
+void
+cond_wait(cond_t *c, mutex_t *m)
+{
+	cond_timedwait(c, m, 0);
+}
+
+void
+cond_signal(cond_t *c)
+{
+	__atomic_add_fetch(&c->sequence, 1, __ATOMIC_RELEASE);
+	futex_wake(&c->sequence, 1);
+}
+
+void
+cond_broadcast(cond_t *c)
+{
+	mutex_t *m = c->mutex;
+
+	__atomic_add_fetch(&c->sequence, 1, __ATOMIC_RELEASE);
+
+	// Waking them all would only have them fight for the mutex
+	if (m)
+		futex_requeue(&c->sequence, 1, &m->state, ALL);
+	else
+		futex_wake(&c->sequence, ALL);
+}
+
+void
+sem_init(sem_t *s, uint32_t value)
+{
+	s->value = value;
+	s->sleepers = 0;
+}
+
+int
+sem_trywait(sem_t *s)
+{
+	uint32_t value = __atomic_load_n(&s->value, __ATOMIC_RELAXED);
+
+	while (value > 0)
+	{
+		if (__atomic_compare_exchange_n(&s->value, &value, value - 1,
+						0, __ATOMIC_ACQUIRE,
+						__ATOMIC_RELAXED))
+			return 0;
+	}
+
+	return -1;
+}
+
+void
+sem_wait(sem_t *s)
+{
+	while (sem_trywait(s) != 0)
+	{
+		// Counted before looking at the value again, in the kernel
+		__atomic_add_fetch(&s->sleepers, 1, __ATOMIC_SEQ_CST);
+		futex_wait(&s->value, 0, 0);
+		__atomic_sub_fetch(&s->sleepers, 1, __ATOMIC_RELAXED);
+	}
+}
+
+void
+sem_post(sem_t *s)
+{
+	__atomic_add_fetch(&s->value, 1, __ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&s->sleepers, __ATOMIC_SEQ_CST) > 0)
+		futex_wake(&s->value, 1);
+}
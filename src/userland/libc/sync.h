@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ *
+ * Mutexes, condition variables and semaphores. They take and release
+ * with atomic instructions alone, and only call in the kernel to sleep
+ * when contended or to wake a sleeper up. Place them in a MAP_SHARED |
+ * MAP_ANONYMOUS mapping made before fork() to synchronize processes.
+ */
+
+#pragma once
+
+#include "stdint.h"
+#include "time.h"
+
+typedef struct mutex {
+	uint32_t state;		/* 0: unlocked, 1: locked, 2: with sleepers */
+} mutex_t;
+
+typedef struct cond {
+	uint32_t sequence;	/* bumped by every signal */
+	mutex_t *mutex;		/* of the last waiter, for cond_broadcast() */
+} cond_t;
+
+typedef struct sem {
+	uint32_t value;
+	uint32_t sleepers;
+} sem_t;
+
+#define MUTEX_INITIALIZER	{ 0 }
+#define COND_INITIALIZER	{ 0, 0 }
+
+void mutex_init(mutex_t *m);
+void mutex_lock(mutex_t *m);
+/* Returns 0 if m was taken, -1 if it is held. */
+int mutex_trylock(mutex_t *m);
+void mutex_unlock(mutex_t *m);
+
+void cond_init(cond_t *c);
+/*
+ * Release m, sleep until signalled, and take m again. Wakeups may be
+ * spurious: check the condition in a loop.
+ */
+void cond_wait(cond_t *c, mutex_t *m);
+/*
+ * Likewise, giving up after timeout. Returns 0 when woken, -1 otherwise;
+ * m is held again either way.
+ */
+int cond_timedwait(cond_t *c, mutex_t *m, const struct timespec *timeout);
+void cond_signal(cond_t *c);
+void cond_broadcast(cond_t *c);
+
+void sem_init(sem_t *s, uint32_t value);
+void sem_wait(sem_t *s);
+/* Returns 0 if the value was taken, -1 if it is 0. */
+int sem_trywait(sem_t *s);
+void sem_post(sem_t *s);
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include "time.h"
+
+#define SYS_CLOCK_GETTIME	16
+#define SYS_NANOSLEEP		17
+#define SYS_WAITPID		18
+
+int
+clock_gettime(int clock, struct timespec *ts)
+{
+	int ret;
+
+	asm volatile("int $0x80"
+		: "=a"(ret)
+		: "a"(SYS_CLOCK_GETTIME), "b"(clock), "c"(ts)
+		: "memory");
+	return ret;
+}
+
+int
+nanosleep(const struct timespec *ts)
+{
+	int ret;
+
+	asm volatile("int $0x80"
+		: "=a"(ret)
+		: "a"(SYS_NANOSLEEP), "b"(ts)
+		: "memory");
+	return ret;
+}
+
+int
+waitpid_timeout(int pid, int *status, const struct timespec *timeout)
+{
+	int ret;
+
+	asm volatile("int $0x80"
+		: "=a"(ret)
+		: "a"(SYS_WAITPID), "b"(pid), "c"(status), "d"(timeout)
+		: "memory");
+	return ret;
+}
+
+unsigned int
+sleep(unsigned int seconds)
+{
+	struct timespec ts = { seconds, 0 };
+
+	nanosleep(&ts);
+	return 0;
+}
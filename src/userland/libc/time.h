@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2026 Konstantin Tcholokachvili.
+ * All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include "stdint.h"
+
+/* Layout matches the kernel's struct timespec. */
+struct timespec {
+	uint32_t tv_sec;
+	uint32_t tv_nsec;
+};
+
+#define CLOCK_MONOTONIC	1	/* since boot, nanosecond resolution */
+
+/* Fill in ts with the time of the given clock. Returns 0, or -1. */
+int clock_gettime(int clock, struct timespec *ts);
+
+/*
+ * Block for at least the given time, rounded up to the kernel tick.
+ * Returns 0, or -1 if tv_nsec is out of range.
+ */
+int nanosleep(const struct timespec *ts);
+
+/*
+ * Reap the child numbered pid, or any child if pid is -1, giving up after
+ * timeout unless NULL; a zero timeout only polls. Returns the pid of the
+ * child, 0 on timeout, or -1 if there is no such child.
+ */
+int waitpid_timeout(int pid, int *status, const struct timespec *timeout);
+
+/* Block for the given number of seconds. Returns 0. */
+unsigned int sleep(unsigned int seconds);
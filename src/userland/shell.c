@@ -1,5 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <memstat.h>
+#include <sched.h>
+#include <time.h>
 
 #define SYS_FS		6
 #define SYS_HALT	7
@@ -149,7 +152,7 @@ tokenize(char *line, char **argv, int max_args)
 }
 
 static int
-run_hello(void)
+run_program(char *path)
 {
 	int status;
 	int pid;
@@ -158,9 +161,9 @@ run_hello(void)
 
 	if (pid == 0)
 	{
-		char *child_argv[] = { "/hello.elf", 0 };
+		char *child_argv[] = { path, 0 };
 
-		exec("/hello.elf", child_argv);
+		exec(path, child_argv);
 		printf("exec failed\n");
 		exit(1);
 	}
@@ -175,6 +178,193 @@ run_hello(void)
 	return 0;
 }
 
+static void
+show_memstat(void)
+{
+	struct frame_stats frames;
+	struct heap_stats heap;
+	struct pool_stats pool;
+	int i;
+
+	if (memstat(MEMSTAT_FRAMES, 0, &frames) < 0
+	    || memstat(MEMSTAT_HEAP, 0, &heap) < 0)
+	{
+		printf("memstat failed\n");
+		return;
+	}
+
+	printf("frames: %u total, %u free, %u peak used\n",
+	       frames.total_frames, frames.free_frames,
+	       frames.peak_used_frames);
+	printf("compaction: %u windows, %u pages migrated\n",
+	       frames.compactions, frames.migrated_pages);
+	printf("order allocs frees failed free-runs frag(1/1000)\n");
+
+	for (i = 0; i < FRAME_STAT_ORDERS; i++)
+	{
+		printf("%d %u %u %u %u %u\n", i, frames.allocs[i],
+		       frames.frees[i], frames.failures[i],
+		       frames.free_runs[i], frames.fragmentation[i]);
+	}
+
+	printf("heap: %u live (%u bytes, %u pages), peak %u bytes / %u pages,"
+	       " %u failed\n", heap.live_allocations, heap.live_bytes,
+	       heap.live_pages, heap.peak_bytes, heap.peak_pages,
+	       heap.failures);
+	printf("size<= allocs frees\n");
+
+	for (i = 0; i < HEAP_STAT_CLASSES; i++)
+	{
+		if (heap.allocs[i] == 0)
+			continue;
+
+		if (i == HEAP_STAT_CLASSES - 1)
+			printf("larger");
+		else
+			printf("%u", 16u << i);
+
+		printf(" %u %u\n", heap.allocs[i], heap.frees[i]);
+	}
+
+	printf("pool block used/blocks peak allocs frees failed\n");
+
+	for (i = 0; memstat(MEMSTAT_POOL, i, &pool) >= 0; i++)
+	{
+		printf("%s %u %u/%u %u %u %u %u\n", pool.name, pool.block_size,
+		       pool.used, pool.nb_blocks, pool.peak_used, pool.allocs,
+		       pool.frees, pool.failures);
+	}
+}
+
+/* Decimal, or hexadecimal with a 0x prefix. Returns -1 on garbage. */
+static int
+parse_number(const char *s, uint32_t *value)
+{
+	uint32_t base = 10;
+	uint32_t digit;
+
+	if (s[0] == '0' && s[1] == 'x')
+	{
+		base = 16;
+		s += 2;
+	}
+
+	if (*s == '\0')
+		return -1;
+
+	for (*value = 0; *s; s++)
+	{
+		if (*s >= '0' && *s <= '9')
+			digit = (uint32_t)(*s - '0');
+		else if (base == 16 && *s >= 'a' && *s <= 'f')
+			digit = (uint32_t)(*s - 'a' + 10);
+		else
+			return -1;
+
+		*value = *value * base + digit;
+	}
+
+	return 0;
+}
+
+/* taskset <mask> [pid] */
+static void
+run_taskset(int argc, char **argv)
+{
+	uint32_t mask;
+	uint32_t pid = 0;
+
+	if (argc < 2 || argc > 3 || parse_number(argv[1], &mask) != 0
+	    || (argc == 3 && parse_number(argv[2], &pid) != 0))
+	{
+		printf("usage: taskset <mask> [pid]\n");
+		return;
+	}
+
+	if (sched_setaffinity((int)pid, mask) < 0)
+		printf("taskset failed\n");
+}
+
+/* renice <value> [pid] */
+static void
+run_renice(int argc, char **argv)
+{
+	const char *value = (argc >= 2) ? argv[1] : "";
+	int negative = (value[0] == '-');
+	uint32_t nice;
+	uint32_t pid = 0;
+
+	if (argc < 2 || argc > 3 || parse_number(value + negative, &nice) != 0
+	    || (argc == 3 && parse_number(argv[2], &pid) != 0))
+	{
+		printf("usage: renice <value> [pid]\n");
+		return;
+	}
+
+	if (setnice((int)pid, negative ? -(int)nice : (int)nice) < 0)
+		printf("renice failed\n");
+}
+
+/* chrt <fifo|rr|normal> <priority> [pid] */
+static void
+run_chrt(int argc, char **argv)
+{
+	int policy = -1;
+	uint32_t priority;
+	uint32_t pid = 0;
+
+	if (argc >= 2)
+	{
+		if (streq(argv[1], "fifo"))
+			policy = SCHED_FIFO;
+		else if (streq(argv[1], "rr"))
+			policy = SCHED_RR;
+		else if (streq(argv[1], "normal"))
+			policy = SCHED_NORMAL;
+	}
+
+	if (argc < 3 || argc > 4 || policy < 0
+	    || parse_number(argv[2], &priority) != 0
+	    || (argc == 4 && parse_number(argv[3], &pid) != 0))
+	{
+		printf("usage: chrt <fifo|rr|normal> <priority> [pid]\n");
+		return;
+	}
+
+	if (sched_setscheduler((int)pid, policy, (int)priority) < 0)
+		printf("chrt failed\n");
+}
+
+/* uptime: time since boot, from the monotonic clock */
+static void
+run_uptime(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+	{
+		printf("uptime failed\n");
+		return;
+	}
+
+	printf("up %u s %u ms\n", ts.tv_sec, ts.tv_nsec / 1000000);
+}
+
+/* sleep <seconds> */
+static void
+run_sleep(int argc, char **argv)
+{
+	uint32_t seconds;
+
+	if (argc != 2 || parse_number(argv[1], &seconds) != 0)
+	{
+		printf("usage: sleep <seconds>\n");
+		return;
+	}
+
+	sleep(seconds);
+}
+
 static int
 run_builtin(int argc, char **argv)
 {
@@ -234,7 +424,58 @@ main(int argc, char **argv)
 
 		if (streq(args[0], "hello"))
 		{
-			run_hello();
+			run_program("/hello.elf");
+			continue;
+		}
+
+		if (streq(args[0], "forktest"))
+		{
+			run_program("/forktest.elf");
+			continue;
+		}
+
+		if (streq(args[0], "memstat"))
+		{
+			if (n >= 2 && streq(args[1], "profile"))
+			{
+				if (memstat(MEMSTAT_PROFILE, 0, 0) < 0)
+					printf("kernel built without PROFILE=on\n");
+			}
+			else
+			{
+				show_memstat();
+			}
+
+			continue;
+		}
+
+		if (streq(args[0], "taskset"))
+		{
+			run_taskset(n, args);
+			continue;
+		}
+
+		if (streq(args[0], "renice"))
+		{
+			run_renice(n, args);
+			continue;
+		}
+
+		if (streq(args[0], "chrt"))
+		{
+			run_chrt(n, args);
+			continue;
+		}
+
+		if (streq(args[0], "uptime"))
+		{
+			run_uptime();
+			continue;
+		}
+
+		if (streq(args[0], "sleep"))
+		{
+			run_sleep(n, args);
 			continue;
 		}
 